@@ -0,0 +1,78 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <limits>
+#include <new>
+
+// Allocates through aligned operator new, so storage starts on an Alignment
+// boundary (a cache line by default) instead of the usual 16 bytes. Through
+// allocate_at_least the storage is also a whole number of Alignment blocks,
+// and circular_buffer takes the elements that fit in the rounding.
+template <typename T, size_t Alignment = cache_line_size>
+class aligned_allocator {
+  static_assert((Alignment & (Alignment - 1)) == 0, "alignment must be a power of two");
+
+  static constexpr std::align_val_t alignment{std::max(Alignment, alignof(T))};
+
+public:
+  using value_type = T;
+
+  using is_always_equal = std::true_type;
+
+  template <typename U>
+  struct rebind {
+    using other = aligned_allocator<U, Alignment>;
+  };
+
+  struct allocation_result {
+    T* ptr;
+    size_t count;
+  };
+
+  aligned_allocator() noexcept = default;
+
+  template <typename U>
+  aligned_allocator(const aligned_allocator<U, Alignment>&) noexcept {}
+
+  T* allocate(size_t n) {
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T), alignment));
+  }
+
+  allocation_result allocate_at_least(size_t n) {
+    size_t block = static_cast<size_t>(alignment);
+    size_t count = n;
+    if (n <= (std::numeric_limits<size_t>::max() - block) / sizeof(T)) {
+      count = (n * sizeof(T) + block - 1) / block * block / sizeof(T);
+    }
+    return {allocate(count), count};
+  }
+
+  // n may be anything from the requested count to the one allocate_at_least
+  // returned, so the unsized delete is used.
+  void deallocate(T* p, size_t) noexcept {
+    ::operator delete(p, alignment);
+  }
+
+  friend bool operator==(const aligned_allocator&, const aligned_allocator&) noexcept {
+    return true;
+  }
+
+  friend bool operator!=(const aligned_allocator&, const aligned_allocator&) noexcept {
+    return false;
+  }
+};
+
+// Pads an element to a whole number of cache lines, so no element shares a
+// line with its neighbours when the storage is cache-line aligned too.
+template <typename T>
+struct alignas(cache_line_size) cache_line_padded {
+  T value;
+};
+
+// circular_buffer whose storage starts on a cache line.
+template <typename T, size_t Alignment = cache_line_size>
+using aligned_circular_buffer = circular_buffer<T, aligned_allocator<T, Alignment>>;
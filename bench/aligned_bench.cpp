@@ -0,0 +1,103 @@
+#include "aligned-allocator.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+// Records of 32 to 256 bytes streamed through a ring larger than the L2
+// cache, so every pop_front reads a slot last touched a full ring ago: with
+// plain operator new storage, with cache-line-aligned storage, and with
+// aligned storage whose records are padded to whole cache lines. All three
+// get circular_buffer's prefetch of the next slots.
+
+namespace {
+
+constexpr size_t ring_bytes = 16 << 20;
+
+template <size_t Size>
+struct record {
+  unsigned char bytes[Size];
+};
+
+template <typename T>
+const auto& payload(const T& value) {
+  return value;
+}
+
+template <typename T>
+const auto& payload(const cache_line_padded<T>& value) {
+  return value.value;
+}
+
+template <typename Buffer>
+void BM_record_stream(benchmark::State& state) {
+  using T = typename Buffer::value_type;
+  size_t count = ring_bytes / sizeof(T);
+  Buffer b;
+  b.reserve(count);
+  T value = {};
+  for (size_t i = 0; i < count; ++i) {
+    b.push_back(value);
+  }
+  uint64_t total = 0;
+  for (auto _ : state) {
+    const auto& oldest = payload(b.front());
+    total += oldest.bytes[0] + oldest.bytes[sizeof(oldest.bytes) - 1];
+    b.pop_front();
+    b.push_back(value);
+  }
+  benchmark::DoNotOptimize(total);
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * sizeof(payload(value)));
+}
+
+template <typename Buffer>
+void BM_record_iterate(benchmark::State& state) {
+  using T = typename Buffer::value_type;
+  size_t count = ring_bytes / sizeof(T);
+  Buffer b;
+  b.reserve(count);
+  T value = {};
+  for (size_t i = 0; i < count + count / 2; ++i) {
+    if (b.size() == count) {
+      b.pop_front();
+    }
+    b.push_back(value);
+  }
+  for (auto _ : state) {
+    uint64_t total = 0;
+    for (const T& element : b) {
+      const auto& r = payload(element);
+      total += r.bytes[0] + r.bytes[sizeof(r.bytes) - 1];
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+template <size_t Size>
+using plain_records = circular_buffer<record<Size>>;
+
+template <size_t Size>
+using aligned_records = aligned_circular_buffer<record<Size>>;
+
+template <size_t Size>
+using padded_records = aligned_circular_buffer<cache_line_padded<record<Size>>>;
+
+} // namespace
+
+#define RECORD_BENCH_SIZE(bm, size)               \
+  BENCHMARK_TEMPLATE(bm, plain_records<size>);   \
+  BENCHMARK_TEMPLATE(bm, aligned_records<size>); \
+  BENCHMARK_TEMPLATE(bm, padded_records<size>)
+
+#define RECORD_BENCH(bm)      \
+  RECORD_BENCH_SIZE(bm, 32);  \
+  RECORD_BENCH_SIZE(bm, 48);  \
+  RECORD_BENCH_SIZE(bm, 64);  \
+  RECORD_BENCH_SIZE(bm, 96);  \
+  RECORD_BENCH_SIZE(bm, 128); \
+  RECORD_BENCH_SIZE(bm, 256)
+
+RECORD_BENCH(BM_record_stream);
+RECORD_BENCH(BM_record_iterate);
@@ -0,0 +1,254 @@
+#include "circular-buffer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef CIRCULAR_BUFFER_BENCH_BOOST
+#include <boost/circular_buffer.hpp>
+#endif
+
+// The basic operations of circular_buffer next to std::deque and, when Boost
+// is found, boost::circular_buffer, for a trivially copyable element and for
+// one that owns heap memory. Every container is filled so its contents wrap
+// before a run is timed.
+
+namespace {
+
+// make_value makes these longer than any small-string buffer, so every copy
+// allocates.
+using heap_string = std::string;
+
+template <typename T>
+T make_value(size_t i);
+
+template <>
+int64_t make_value<int64_t>(size_t i) {
+  return static_cast<int64_t>(i);
+}
+
+template <>
+heap_string make_value<heap_string>(size_t i) {
+  heap_string value(40, 'x');
+  value[i % value.size()] = 'y';
+  return value;
+}
+
+size_t weight(int64_t value) {
+  return static_cast<size_t>(value);
+}
+
+size_t weight(const heap_string& value) {
+  return value.size();
+}
+
+// Uniform access to the containers. boost::circular_buffer never grows on
+// its own, so its adapter doubles the capacity of a full buffer, the way a
+// caller would use it as an unbounded queue.
+template <typename C>
+struct adapter {
+  static constexpr bool is_deque = std::is_same_v<C, std::deque<typename C::value_type>>;
+
+  static C make(size_t capacity) {
+    C c;
+    reserve(c, capacity);
+    return c;
+  }
+
+  static void reserve(C& c, size_t capacity) {
+    if constexpr (!is_deque) {
+      c.reserve(capacity);
+    }
+  }
+
+  template <typename V>
+  static void push_back(C& c, V&& value) {
+    c.push_back(std::forward<V>(value));
+  }
+
+  template <typename V>
+  static void push_front(C& c, V&& value) {
+    c.push_front(std::forward<V>(value));
+  }
+};
+
+#ifdef CIRCULAR_BUFFER_BENCH_BOOST
+template <typename T>
+struct adapter<boost::circular_buffer<T>> {
+  using C = boost::circular_buffer<T>;
+
+  static C make(size_t capacity) {
+    return C(capacity);
+  }
+
+  static void reserve(C& c, size_t capacity) {
+    if (c.capacity() < capacity) {
+      c.set_capacity(capacity);
+    }
+  }
+
+  template <typename V>
+  static void push_back(C& c, V&& value) {
+    if (c.full()) {
+      c.set_capacity(std::max<size_t>(1, c.capacity() * 2));
+    }
+    c.push_back(std::forward<V>(value));
+  }
+
+  template <typename V>
+  static void push_front(C& c, V&& value) {
+    if (c.full()) {
+      c.set_capacity(std::max<size_t>(1, c.capacity() * 2));
+    }
+    c.push_front(std::forward<V>(value));
+  }
+};
+#endif
+
+// count elements, with the front moved half way through storage so the
+// contents wrap.
+template <typename C>
+C make_filled(size_t count) {
+  using T = typename C::value_type;
+  C c = adapter<C>::make(count);
+  for (size_t i = 0; i < count; ++i) {
+    adapter<C>::push_back(c, make_value<T>(i));
+  }
+  for (size_t i = 0; i < count / 2; ++i) {
+    c.pop_front();
+    adapter<C>::push_back(c, make_value<T>(i));
+  }
+  return c;
+}
+
+template <typename C>
+void BM_push_back_pop_front(benchmark::State& state) {
+  using T = typename C::value_type;
+  C c = make_filled<C>(static_cast<size_t>(state.range(0)));
+  T value = make_value<T>(7);
+  for (auto _ : state) {
+    adapter<C>::push_back(c, value);
+    c.pop_front();
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename C>
+void BM_push_front(benchmark::State& state) {
+  using T = typename C::value_type;
+  size_t count = static_cast<size_t>(state.range(0));
+  C c = adapter<C>::make(count);
+  T value = make_value<T>(7);
+  for (auto _ : state) {
+    c.clear();
+    for (size_t i = 0; i < count; ++i) {
+      adapter<C>::push_front(c, value);
+    }
+    benchmark::DoNotOptimize(c.front());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename C>
+void BM_random_access(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  C c = make_filled<C>(count);
+  std::vector<size_t> indices(4096);
+  std::mt19937_64 random(42);
+  for (size_t& index : indices) {
+    index = random() % count;
+  }
+  for (auto _ : state) {
+    size_t total = 0;
+    for (size_t index : indices) {
+      total += weight(c[index]);
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * indices.size());
+}
+
+template <typename C>
+void BM_iterate(benchmark::State& state) {
+  C c = make_filled<C>(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    size_t total = 0;
+    for (const auto& value : c) {
+      total += weight(value);
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename C>
+void BM_insert_erase_middle(benchmark::State& state) {
+  using T = typename C::value_type;
+  size_t count = static_cast<size_t>(state.range(0));
+  C c = make_filled<C>(count);
+  adapter<C>::reserve(c, count + 1);
+  T value = make_value<T>(7);
+  for (auto _ : state) {
+    c.insert(c.begin() + count / 2, value);
+    c.erase(c.begin() + count / 2);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Pushes into an empty container, so every doubling of the storage is timed.
+template <typename C>
+void BM_growth(benchmark::State& state) {
+  using T = typename C::value_type;
+  size_t count = static_cast<size_t>(state.range(0));
+  T value = make_value<T>(7);
+  for (auto _ : state) {
+    C c = adapter<C>::make(1);
+    for (size_t i = 0; i < count; ++i) {
+      adapter<C>::push_back(c, value);
+    }
+    benchmark::DoNotOptimize(c.back());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename C>
+void BM_copy(benchmark::State& state) {
+  C c = make_filled<C>(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    C copy(c);
+    benchmark::DoNotOptimize(copy.back());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+#define CIRCULAR_BUFFER_BENCH_ONE(bm, ...) BENCHMARK_TEMPLATE(bm, __VA_ARGS__)->RangeMultiplier(16)->Range(64, 1 << 16)
+
+#ifdef CIRCULAR_BUFFER_BENCH_BOOST
+#define CIRCULAR_BUFFER_BENCH_BOOST_ONE(bm, T) CIRCULAR_BUFFER_BENCH_ONE(bm, boost::circular_buffer<T>)
+#else
+#define CIRCULAR_BUFFER_BENCH_BOOST_ONE(bm, T) static_assert(true)
+#endif
+
+#define CIRCULAR_BUFFER_BENCH(bm)                                \
+  CIRCULAR_BUFFER_BENCH_ONE(bm, circular_buffer<int64_t>);       \
+  CIRCULAR_BUFFER_BENCH_ONE(bm, std::deque<int64_t>);            \
+  CIRCULAR_BUFFER_BENCH_BOOST_ONE(bm, int64_t);                  \
+  CIRCULAR_BUFFER_BENCH_ONE(bm, circular_buffer<heap_string>);   \
+  CIRCULAR_BUFFER_BENCH_ONE(bm, std::deque<heap_string>);        \
+  CIRCULAR_BUFFER_BENCH_BOOST_ONE(bm, heap_string)
+
+CIRCULAR_BUFFER_BENCH(BM_push_back_pop_front);
+CIRCULAR_BUFFER_BENCH(BM_push_front);
+CIRCULAR_BUFFER_BENCH(BM_random_access);
+CIRCULAR_BUFFER_BENCH(BM_iterate);
+CIRCULAR_BUFFER_BENCH(BM_insert_erase_middle);
+CIRCULAR_BUFFER_BENCH(BM_growth);
+CIRCULAR_BUFFER_BENCH(BM_copy);
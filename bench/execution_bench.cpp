@@ -0,0 +1,120 @@
+#include "circular-buffer-execution.h"
+
+#include <benchmark/benchmark.h>
+
+#include <tbb/global_control.h>
+
+#include <algorithm>
+#include <execution>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+// The cb:: execution-policy algorithms against the standard ones run through
+// buffer_iterator, with std::execution::par on 1 to 32 TBB threads over a
+// wrapped ring of 4M doubles.
+
+namespace {
+
+constexpr size_t ring_size = 1 << 22;
+
+std::vector<double> make_values() {
+  std::mt19937_64 random(42);
+  std::uniform_real_distribution<double> distribution(0, 1);
+  std::vector<double> values(ring_size);
+  for (double& value : values) {
+    value = distribution(random);
+  }
+  return values;
+}
+
+// values, with the front moved half way through storage so the contents
+// wrap.
+circular_buffer<double> make_ring(const std::vector<double>& values) {
+  circular_buffer<double> b(values.size());
+  for (size_t i = 0; i < values.size() / 2; ++i) {
+    b.push_back(0);
+  }
+  b.consume_front(values.size() / 2);
+  b.append(values.begin(), values.end());
+  return b;
+}
+
+// cb:: over array_one() and array_two(), or std:: over begin() and end().
+struct by_runs {};
+struct by_iterator {};
+
+struct scale {
+  void operator()(double& x) const noexcept {
+    x = x * 0.999 + 0.001;
+  }
+};
+
+struct square {
+  double operator()(double x) const noexcept {
+    return x * x;
+  }
+};
+
+template <typename Mode>
+void BM_exec_for_each(benchmark::State& state) {
+  tbb::global_control threads(tbb::global_control::max_allowed_parallelism, static_cast<size_t>(state.range(0)));
+  circular_buffer<double> b = make_ring(make_values());
+  for (auto _ : state) {
+    if constexpr (std::is_same_v<Mode, by_runs>) {
+      cb::for_each(std::execution::par, b, scale());
+    } else {
+      std::for_each(std::execution::par, b.begin(), b.end(), scale());
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * ring_size);
+}
+
+template <typename Mode>
+void BM_exec_transform_reduce(benchmark::State& state) {
+  tbb::global_control threads(tbb::global_control::max_allowed_parallelism, static_cast<size_t>(state.range(0)));
+  circular_buffer<double> b = make_ring(make_values());
+  for (auto _ : state) {
+    double total;
+    if constexpr (std::is_same_v<Mode, by_runs>) {
+      total = cb::transform_reduce(std::execution::par, b, 0.0, std::plus<>(), square());
+    } else {
+      total = std::transform_reduce(std::execution::par, b.begin(), b.end(), 0.0, std::plus<>(), square());
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * ring_size);
+}
+
+// Every run sorts the same shuffled values, wrapped the same way.
+template <typename Mode>
+void BM_exec_sort(benchmark::State& state) {
+  tbb::global_control threads(tbb::global_control::max_allowed_parallelism, static_cast<size_t>(state.range(0)));
+  const std::vector<double> values = make_values();
+  for (auto _ : state) {
+    state.PauseTiming();
+    circular_buffer<double> b = make_ring(values);
+    state.ResumeTiming();
+    if constexpr (std::is_same_v<Mode, by_runs>) {
+      cb::sort(std::execution::par, b);
+    } else {
+      std::sort(std::execution::par, b.begin(), b.end());
+    }
+    benchmark::DoNotOptimize(b.front());
+  }
+  state.SetItemsProcessed(state.iterations() * ring_size);
+}
+
+} // namespace
+
+#define EXEC_BENCH_ONE(bm, mode) \
+  BENCHMARK_TEMPLATE(bm, mode)->RangeMultiplier(2)->Range(1, 32)->UseRealTime()->Unit(benchmark::kMillisecond)
+
+#define EXEC_BENCH(bm)            \
+  EXEC_BENCH_ONE(bm, by_runs);    \
+  EXEC_BENCH_ONE(bm, by_iterator)
+
+EXEC_BENCH(BM_exec_for_each);
+EXEC_BENCH(BM_exec_transform_reduce);
+EXEC_BENCH(BM_exec_sort);
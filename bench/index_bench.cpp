@@ -0,0 +1,86 @@
+#include "circular-buffer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// modulo_index against pow2_index on the paths every access goes through:
+// operator[], iteration and push_back/pop_front. Both buffers get the same
+// power-of-two capacity, so the only difference is % against &.
+
+namespace {
+
+using modulo_buffer = circular_buffer<int64_t>;
+using pow2_buffer = circular_buffer_pow2<int64_t>;
+
+// count elements in storage of count, with the front moved half way through
+// so the contents wrap.
+template <typename Buffer>
+Buffer make_filled(size_t count) {
+  Buffer b;
+  b.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    b.push_back(static_cast<int64_t>(i));
+  }
+  for (size_t i = 0; i < count / 2; ++i) {
+    b.pop_front();
+    b.push_back(static_cast<int64_t>(i));
+  }
+  return b;
+}
+
+template <typename Buffer>
+void BM_index_random_access(benchmark::State& state) {
+  size_t count = static_cast<size_t>(state.range(0));
+  Buffer b = make_filled<Buffer>(count);
+  std::vector<size_t> indices(4096);
+  std::mt19937_64 random(42);
+  for (size_t& index : indices) {
+    index = random() % count;
+  }
+  for (auto _ : state) {
+    int64_t total = 0;
+    for (size_t index : indices) {
+      total += b[index];
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * indices.size());
+}
+
+template <typename Buffer>
+void BM_index_iterate(benchmark::State& state) {
+  Buffer b = make_filled<Buffer>(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    int64_t total = 0;
+    for (auto it = b.begin(); it != b.end(); ++it) {
+      total += *it;
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename Buffer>
+void BM_index_push_back_pop_front(benchmark::State& state) {
+  Buffer b = make_filled<Buffer>(static_cast<size_t>(state.range(0)));
+  int64_t value = 7;
+  for (auto _ : state) {
+    b.push_back(value);
+    b.pop_front();
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+#define INDEX_BENCH(bm)                                                         \
+  BENCHMARK_TEMPLATE(bm, modulo_buffer)->RangeMultiplier(16)->Range(64, 1 << 16); \
+  BENCHMARK_TEMPLATE(bm, pow2_buffer)->RangeMultiplier(16)->Range(64, 1 << 16)
+
+INDEX_BENCH(BM_index_random_access);
+INDEX_BENCH(BM_index_iterate);
+INDEX_BENCH(BM_index_push_back_pop_front);
@@ -0,0 +1,75 @@
+#include "circular-buffer.h"
+#include "mpmc-circular-buffer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// mpmc_circular_buffer against the std::mutex + circular_buffer pair it
+// replaces, at 1 to 64 threads. Every thread pushes one element and pops
+// one, so all of them both produce and consume on the one shared queue.
+
+namespace {
+
+constexpr size_t queue_capacity = 1024;
+
+class locked_queue {
+  std::mutex mutex_;
+  circular_buffer<int64_t> buffer_;
+
+public:
+  explicit locked_queue(size_t capacity) : buffer_(capacity) {}
+
+  bool try_push(int64_t val) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (buffer_.size() == buffer_.capacity()) {
+      return false;
+    }
+    buffer_.push_back(val);
+    return true;
+  }
+
+  bool try_pop(int64_t& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (buffer_.empty()) {
+      return false;
+    }
+    out = buffer_.front();
+    buffer_.pop_front();
+    return true;
+  }
+};
+
+// Built by thread 0 before the timed loop, whose start and end the other
+// threads wait for.
+template <typename Queue>
+std::unique_ptr<Queue> shared_queue;
+
+template <typename Queue>
+void BM_mpmc_push_pop(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_queue<Queue> = std::make_unique<Queue>(queue_capacity);
+  }
+  int64_t value = state.thread_index();
+  for (auto _ : state) {
+    Queue& queue = *shared_queue<Queue>;
+    while (!queue.try_push(value)) {
+      std::this_thread::yield();
+    }
+    while (!queue.try_pop(value)) {
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    shared_queue<Queue>.reset();
+  }
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_mpmc_push_pop, mpmc_circular_buffer<int64_t>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_mpmc_push_pop, locked_queue)->ThreadRange(1, 64)->UseRealTime();
@@ -0,0 +1,78 @@
+#include "circular-buffer.h"
+#include "sharded-ring.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Push throughput of 1 to 32 producer threads into one sharded_ring, a shard
+// each, against a single circular_buffer behind a std::mutex, the shared
+// trace buffer sharded_ring replaces. A producer that finds its buffer full
+// drains it itself, so both sides keep pushing at a steady state.
+
+namespace {
+
+constexpr size_t shard_capacity = 4096;
+
+struct event {
+  uint64_t sequence;
+  uint64_t payload;
+};
+
+class locked_ring {
+  std::mutex mutex_;
+  circular_buffer<event> buffer_;
+
+public:
+  locked_ring(size_t producers, size_t capacity) : buffer_(producers * capacity) {}
+
+  void push(size_t, const event& e) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (buffer_.size() == buffer_.capacity()) {
+      buffer_.clear();
+    }
+    buffer_.push_back(e);
+  }
+};
+
+class sharded {
+  sharded_ring<event> ring_;
+
+public:
+  sharded(size_t producers, size_t capacity) : ring_(producers, capacity) {}
+
+  void push(size_t shard, const event& e) {
+    while (!ring_.try_push(shard, e)) {
+      ring_.drain(shard, [](event* first, size_t) { benchmark::DoNotOptimize(first); });
+    }
+  }
+};
+
+// Built by thread 0 before the timed loop, whose start and end the other
+// threads wait for.
+template <typename Ring>
+std::unique_ptr<Ring> shared_ring;
+
+template <typename Ring>
+void BM_trace_push(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_ring<Ring> = std::make_unique<Ring>(static_cast<size_t>(state.threads()), shard_capacity);
+  }
+  size_t shard = static_cast<size_t>(state.thread_index());
+  event e = {0, shard};
+  for (auto _ : state) {
+    shared_ring<Ring>->push(shard, e);
+    ++e.sequence;
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    shared_ring<Ring>.reset();
+  }
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_trace_push, sharded)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_trace_push, locked_ring)->ThreadRange(1, 32)->UseRealTime();
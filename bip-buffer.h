@@ -0,0 +1,192 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <cstdint>
+
+// Byte ring that hands out contiguous regions only (Simon Cooke's bip
+// buffer). Live bytes are region A, head_ and size_ as in circular_buffer,
+// followed by region B at the start of storage once writing has wrapped.
+// Instead of splitting a write at the end of storage, reserve starts B and
+// leaves the tail unused until A drains, then B becomes A. On top of the raw
+// reserve/commit and readable/consume calls, records are stored with a
+// 4-byte length prefix and always come back whole.
+template <typename Allocator = std::allocator<unsigned char>>
+class basic_bip_buffer {
+  using alloc_traits = std::allocator_traits<Allocator>;
+
+  static_assert(std::is_same_v<typename alloc_traits::value_type, unsigned char>, "Allocator must allocate bytes");
+
+  unsigned char* data_;
+  size_t capacity_;
+  size_t head_;
+  size_t size_;
+  size_t wrapped_;
+  size_t reserve_start_;
+  size_t reserve_size_;
+  Allocator alloc_;
+
+public:
+  using allocator_type = Allocator;
+
+  // Contiguous bytes: first byte and count.
+  using const_array_range = std::pair<const unsigned char*, size_t>;
+
+  static constexpr size_t record_prefix = sizeof(uint32_t);
+
+public:
+  // O(1), strong
+  explicit basic_bip_buffer(size_t capacity, const Allocator& alloc = Allocator())
+      : data_(nullptr),
+        capacity_(capacity),
+        head_(0),
+        size_(0),
+        wrapped_(0),
+        reserve_start_(0),
+        reserve_size_(0),
+        alloc_(alloc) {
+    if (capacity_ != 0) {
+      data_ = alloc_traits::allocate(alloc_, capacity_);
+    }
+  }
+
+  basic_bip_buffer(const basic_bip_buffer&) = delete;
+  basic_bip_buffer& operator=(const basic_bip_buffer&) = delete;
+
+  // O(1), nothrow
+  ~basic_bip_buffer() {
+    if (data_ != nullptr) {
+      alloc_traits::deallocate(alloc_, data_, capacity_);
+    }
+  }
+
+  // O(1), nothrow
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  // O(1), nothrow
+  // Committed bytes in both regions.
+  size_t size() const noexcept {
+    return size_ + wrapped_;
+  }
+
+  // O(1), nothrow
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  // O(1), nothrow
+  // Returns count contiguous writable bytes, or nullptr when no gap is that
+  // large. A later reserve replaces the pending one; one that fails changes
+  // nothing, so the pending reservation can still be committed.
+  unsigned char* reserve(size_t count) noexcept {
+    // An empty buffer writes from the start of storage again, but head_ only
+    // moves there once the reservation is known to fit.
+    size_t head = size() == 0 ? 0 : head_;
+    size_t start = head + size_;
+    if (wrapped_ != 0 || capacity_ - start < count) {
+      // Only the gap between B and A is left.
+      start = wrapped_;
+      if (head - start < count) {
+        return nullptr;
+      }
+    }
+    head_ = head;
+    reserve_start_ = start;
+    reserve_size_ = count;
+    return data_ + reserve_start_;
+  }
+
+  // O(1), nothrow
+  // Makes the first count bytes of the pending reservation readable.
+  void commit(size_t count) noexcept {
+    assert(count <= reserve_size_);
+    if (wrapped_ == 0 && reserve_start_ == head_ + size_) {
+      size_ += count;
+    } else {
+      wrapped_ += count;
+      // A was consumed while the reservation was pending, so B takes over.
+      if (size_ == 0) {
+        head_ = 0;
+        size_ = wrapped_;
+        wrapped_ = 0;
+      }
+    }
+    reserve_size_ = 0;
+  }
+
+  // O(1), nothrow
+  // The oldest contiguous committed bytes.
+  const_array_range readable() const noexcept {
+    return {data_ + head_, size_};
+  }
+
+  // O(1), nothrow
+  // Releases the first count bytes of readable().
+  void consume(size_t count) noexcept {
+    assert(count <= size_);
+    head_ += count;
+    size_ -= count;
+    if (size_ == 0 && wrapped_ != 0) {
+      head_ = 0;
+      size_ = wrapped_;
+      wrapped_ = 0;
+    }
+  }
+
+  // O(1), nothrow
+  // Reserves room for a record of length bytes and returns where its bytes go.
+  unsigned char* reserve_record(size_t length) noexcept {
+    assert(length <= UINT32_MAX);
+    unsigned char* first = reserve(record_prefix + length);
+    return first == nullptr ? nullptr : first + record_prefix;
+  }
+
+  // O(1), nothrow
+  // Commits a record of length bytes written after reserve_record.
+  void commit_record(size_t length) noexcept {
+    assert(record_prefix + length <= reserve_size_);
+    uint32_t prefix = static_cast<uint32_t>(length);
+    std::memcpy(data_ + reserve_start_, &prefix, record_prefix);
+    commit(record_prefix + length);
+  }
+
+  // O(n), nothrow
+  // Returns false when there is no contiguous room for the record.
+  bool push_record(const void* src, size_t length) noexcept {
+    unsigned char* first = reserve_record(length);
+    if (first == nullptr) {
+      return false;
+    }
+    if (length != 0) {
+      std::memcpy(first, src, length);
+    }
+    commit_record(length);
+    return true;
+  }
+
+  // O(1), nothrow
+  // Bytes of the oldest record; the buffer must hold one.
+  const_array_range front_record() const noexcept {
+    assert(size_ >= record_prefix);
+    uint32_t length;
+    std::memcpy(&length, data_ + head_, record_prefix);
+    return {data_ + head_ + record_prefix, length};
+  }
+
+  // O(1), nothrow
+  void pop_record() noexcept {
+    consume(record_prefix + front_record().second);
+  }
+
+  // O(1), nothrow
+  void clear() noexcept {
+    head_ = 0;
+    size_ = 0;
+    wrapped_ = 0;
+    reserve_size_ = 0;
+  }
+};
+
+using bip_buffer = basic_bip_buffer<>;
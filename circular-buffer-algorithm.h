@@ -0,0 +1,286 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CIRCULAR_BUFFER_AVX2_DISPATCH 1
+#endif
+
+// Algorithms over any buffer with array_one() and array_two(). Each runs once
+// per contiguous run instead of through the wrapping iterator, so the loops
+// see plain pointers and vectorize. On x86-64, find and count over 1- and
+// 4-byte integers and sum and minmax over arithmetic types switch to AVX2
+// code when the CPU has it, checked once at run time.
+namespace cb {
+namespace detail {
+
+template <typename T>
+inline constexpr bool is_simd_integer_v =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> && (sizeof(T) == 1 || sizeof(T) == 4);
+
+// Default accumulator of sum: at least long long for integers and double for
+// floating point, so sums of small types do not wrap or lose precision.
+template <typename T, typename = void>
+struct sum_type {
+  using type = T;
+};
+
+template <typename T>
+struct sum_type<T, std::enable_if_t<std::is_integral_v<T>>> {
+  using type = std::common_type_t<T, long long>;
+};
+
+template <typename T>
+struct sum_type<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  using type = std::common_type_t<T, double>;
+};
+
+template <typename T>
+using sum_type_t = typename sum_type<T>::type;
+
+template <typename T>
+size_t find_n(const T* first, size_t count, const T& value) {
+  for (size_t i = 0; i < count; ++i) {
+    if (first[i] == value) {
+      return i;
+    }
+  }
+  return count;
+}
+
+template <typename T>
+size_t count_n(const T* first, size_t count, const T& value) {
+  size_t result = 0;
+  for (size_t i = 0; i < count; ++i) {
+    result += first[i] == value;
+  }
+  return result;
+}
+
+// Eight independent partial sums, so the adds do not wait on each other and
+// the loop vectorizes even for floating point, whose sums may therefore differ
+// from std::accumulate in the last bits.
+template <typename T, typename U>
+inline U sum_n(const T* first, size_t count, U init) {
+  size_t i = 0;
+  if constexpr (std::is_arithmetic_v<U>) {
+    U lanes[8] = {};
+    for (; i + 8 <= count; i += 8) {
+      for (size_t j = 0; j < 8; ++j) {
+        lanes[j] += first[i + j];
+      }
+    }
+    for (U lane : lanes) {
+      init += lane;
+    }
+  }
+  for (; i < count; ++i) {
+    init += first[i];
+  }
+  return init;
+}
+
+// Runs on locals, written back once: through lo and hi every store could
+// alias first, and the loop would neither stay in registers nor vectorize.
+template <typename T>
+inline void minmax_n(const T* first, size_t count, T& lo, T& hi) {
+  T min = lo;
+  T max = hi;
+  for (size_t i = 0; i < count; ++i) {
+    min = first[i] < min ? first[i] : min;
+    max = max < first[i] ? first[i] : max;
+  }
+  lo = min;
+  hi = max;
+}
+
+#ifdef CIRCULAR_BUFFER_AVX2_DISPATCH
+inline bool has_avx2() noexcept {
+  static const bool result = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+  return result;
+}
+
+// One bit per matching byte of a 32-byte block.
+template <typename T>
+__attribute__((target("avx2"))) unsigned match_mask(const T* block, __m256i needle) noexcept {
+  __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  if constexpr (sizeof(T) == 1) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(lanes, needle));
+  } else {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi32(lanes, needle));
+  }
+}
+
+template <typename T>
+__attribute__((target("avx2"))) __m256i splat(T value) noexcept {
+  if constexpr (sizeof(T) == 1) {
+    return _mm256_set1_epi8(static_cast<char>(value));
+  } else {
+    return _mm256_set1_epi32(static_cast<int>(value));
+  }
+}
+
+template <typename T>
+__attribute__((target("avx2"))) size_t find_n_avx2(const T* first, size_t count, T value) {
+  constexpr size_t lanes = 32 / sizeof(T);
+  __m256i needle = splat(value);
+  size_t i = 0;
+  for (; i + lanes <= count; i += lanes) {
+    unsigned mask = match_mask(first + i, needle);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask) / sizeof(T);
+    }
+  }
+  return i + find_n(first + i, count - i, value);
+}
+
+template <typename T>
+__attribute__((target("avx2"))) size_t count_n_avx2(const T* first, size_t count, T value) {
+  constexpr size_t lanes = 32 / sizeof(T);
+  __m256i needle = splat(value);
+  size_t result = 0;
+  size_t i = 0;
+  for (; i + lanes <= count; i += lanes) {
+    result += __builtin_popcount(match_mask(first + i, needle)) / sizeof(T);
+  }
+  return result + count_n(first + i, count - i, value);
+}
+
+// The portable loops, compiled again for AVX2 once inlined here.
+template <typename T, typename U>
+__attribute__((target("avx2"))) U sum_n_avx2(const T* first, size_t count, U init) {
+  return sum_n(first, count, init);
+}
+
+template <typename T>
+__attribute__((target("avx2"))) void minmax_n_avx2(const T* first, size_t count, T& lo, T& hi) {
+  minmax_n(first, count, lo, hi);
+}
+#endif
+
+template <typename T>
+size_t find_run(const T* first, size_t count, const T& value) {
+#ifdef CIRCULAR_BUFFER_AVX2_DISPATCH
+  if constexpr (is_simd_integer_v<T>) {
+    if (has_avx2()) {
+      return find_n_avx2(first, count, value);
+    }
+  }
+#endif
+  return find_n(first, count, value);
+}
+
+template <typename T>
+size_t count_run(const T* first, size_t count, const T& value) {
+#ifdef CIRCULAR_BUFFER_AVX2_DISPATCH
+  if constexpr (is_simd_integer_v<T>) {
+    if (has_avx2()) {
+      return count_n_avx2(first, count, value);
+    }
+  }
+#endif
+  return count_n(first, count, value);
+}
+
+template <typename T, typename U>
+U sum_run(const T* first, size_t count, U init) {
+#ifdef CIRCULAR_BUFFER_AVX2_DISPATCH
+  if constexpr (std::is_arithmetic_v<T> && std::is_arithmetic_v<U>) {
+    if (has_avx2()) {
+      return sum_n_avx2(first, count, init);
+    }
+  }
+#endif
+  return sum_n(first, count, init);
+}
+
+template <typename T>
+void minmax_run(const T* first, size_t count, T& lo, T& hi) {
+#ifdef CIRCULAR_BUFFER_AVX2_DISPATCH
+  if constexpr (std::is_arithmetic_v<T>) {
+    if (has_avx2()) {
+      minmax_n_avx2(first, count, lo, hi);
+      return;
+    }
+  }
+#endif
+  minmax_n(first, count, lo, hi);
+}
+
+inline size_t memchr_run(const void* first, size_t count, int byte) noexcept {
+  if (count == 0) {
+    return 0;
+  }
+  const void* hit = std::memchr(first, byte, count);
+  return hit == nullptr ? count : static_cast<const unsigned char*>(hit) - static_cast<const unsigned char*>(first);
+}
+
+} // namespace detail
+
+// O(n)
+// First element equal to value, or end().
+template <typename Buffer>
+auto find(Buffer& buffer, const typename Buffer::value_type& value) -> decltype(buffer.begin()) {
+  auto one = buffer.array_one();
+  size_t index = detail::find_run<typename Buffer::value_type>(one.first, one.second, value);
+  if (index == one.second) {
+    auto two = buffer.array_two();
+    index += detail::find_run<typename Buffer::value_type>(two.first, two.second, value);
+  }
+  return buffer.begin() + index;
+}
+
+// O(n)
+template <typename Buffer>
+size_t count(const Buffer& buffer, const typename Buffer::value_type& value) {
+  auto one = buffer.array_one();
+  auto two = buffer.array_two();
+  return detail::count_run(one.first, one.second, value) + detail::count_run(two.first, two.second, value);
+}
+
+// O(n)
+// init plus every element, summed in an unspecified order. Unless U is
+// given, integers are summed as long long or wider and floating point as
+// double or wider.
+template <typename Buffer, typename U = detail::sum_type_t<typename Buffer::value_type>>
+U sum(const Buffer& buffer, U init = U()) {
+  auto one = buffer.array_one();
+  auto two = buffer.array_two();
+  return detail::sum_run(two.first, two.second, detail::sum_run(one.first, one.second, init));
+}
+
+// O(n)
+// Smallest and largest element; the buffer must not be empty.
+template <typename Buffer>
+std::pair<typename Buffer::value_type, typename Buffer::value_type> minmax(const Buffer& buffer) {
+  assert(!buffer.empty());
+  auto one = buffer.array_one();
+  auto two = buffer.array_two();
+  typename Buffer::value_type lo = *one.first;
+  typename Buffer::value_type hi = *one.first;
+  detail::minmax_run(one.first, one.second, lo, hi);
+  detail::minmax_run(two.first, two.second, lo, hi);
+  return {lo, hi};
+}
+
+// O(n)
+// Like find for buffers of bytes, using the C library's std::memchr.
+template <typename Buffer>
+auto memchr(Buffer& buffer, int byte) -> decltype(buffer.begin()) {
+  static_assert(sizeof(typename Buffer::value_type) == 1 && std::is_trivially_copyable_v<typename Buffer::value_type>,
+                "memchr searches buffers of bytes");
+  auto one = buffer.array_one();
+  auto two = buffer.array_two();
+  size_t index = detail::memchr_run(one.first, one.second, byte);
+  if (index == one.second) {
+    index += detail::memchr_run(two.first, two.second, byte);
+  }
+  return buffer.begin() + index;
+}
+
+} // namespace cb
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+
+#ifndef __cpp_lib_execution
+#error "circular-buffer-execution.h needs the C++17 execution policies"
+#endif
+
+// Standard parallel algorithms over a buffer, run on its contiguous runs
+// (array_one() and array_two()) with plain pointers, which the parallel
+// backend can split into chunks across threads without ever crossing the
+// wrap point. Which policies really run in parallel depends on the standard
+// library: libstdc++, for one, needs TBB.
+namespace cb {
+namespace detail {
+
+template <typename Policy>
+using enable_if_policy_t = std::enable_if_t<std::is_execution_policy_v<std::decay_t<Policy>>, int>;
+
+} // namespace detail
+
+// O(n / threads)
+template <typename Policy, typename Buffer, typename F, detail::enable_if_policy_t<Policy> = 0>
+void for_each(Policy&& policy, Buffer& buffer, F f) {
+  auto one = buffer.array_one();
+  auto two = buffer.array_two();
+  std::for_each(policy, one.first, one.first + one.second, f);
+  std::for_each(policy, two.first, two.first + two.second, f);
+}
+
+// O(n / threads)
+// reduce must be associative and commutative, as for std::transform_reduce.
+template <typename Policy, typename Buffer, typename U, typename Reduce, typename Transform,
+          detail::enable_if_policy_t<Policy> = 0>
+U transform_reduce(Policy&& policy, const Buffer& buffer, U init, Reduce reduce, Transform transform) {
+  auto one = buffer.array_one();
+  auto two = buffer.array_two();
+  init = std::transform_reduce(policy, one.first, one.first + one.second, std::move(init), reduce, transform);
+  return std::transform_reduce(policy, two.first, two.first + two.second, std::move(init), reduce, transform);
+}
+
+// O(n log n / threads), basic
+// Linearizes the buffer first, so the whole sort runs on one contiguous range.
+template <typename Policy, typename Buffer, typename Compare = std::less<>, detail::enable_if_policy_t<Policy> = 0>
+void sort(Policy&& policy, Buffer& buffer, Compare comp = Compare()) {
+  auto first = buffer.linearize();
+  std::sort(policy, first, first + buffer.size(), comp);
+}
+
+} // namespace cb
@@ -1,18 +1,159 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
 
-template <typename T>
-class circular_buffer {
+// Assumed size of a cache line, used to keep independently written state apart.
+inline constexpr size_t cache_line_size = 64;
+
+// Asks the cache for the line holding p ahead of a read, or of a write when
+// Write is set. A hint only: p may be one past the end of storage.
+template <bool Write = false>
+inline void prefetch(const void* p) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(p, Write ? 1 : 0);
+#else
+  (void)p;
+#endif
+}
+
+// Index policies: map a logical position onto a slot of storage
+// with the given capacity and choose which capacities are allowed.
+
+// Any capacity, one division per access.
+struct modulo_index {
+  static constexpr size_t wrap(size_t index, size_t capacity) noexcept {
+    return index % capacity;
+  }
+
+  static constexpr size_t round_capacity(size_t capacity) noexcept {
+    return capacity;
+  }
+};
+
+// Power-of-two capacities only, one mask per access.
+struct pow2_index {
+  static constexpr size_t wrap(size_t index, size_t capacity) noexcept {
+    return index & (capacity - 1);
+  }
+
+  // Throws std::length_error when no power of two holds capacity.
+  static constexpr size_t round_capacity(size_t capacity) {
+    if (capacity > (std::numeric_limits<size_t>::max() >> 1) + 1) {
+      throw std::length_error("pow2_index: capacity too large");
+    }
+    size_t result = 1;
+    while (result < capacity) {
+      result <<= 1;
+    }
+    return capacity == 0 ? 0 : result;
+  }
+};
+
+// Growth policies: decide what a push into a full buffer does and, when it
+// reallocates, how many elements the next storage holds.
+
+// Multiplies the capacity by Num / Den, starting from MinCapacity.
+template <size_t Num, size_t Den = 1, size_t MinCapacity = 1>
+struct grow_by_factor {
+  static_assert(Num > Den && MinCapacity != 0, "growth must make room");
+
+  static constexpr bool overwrite = false;
+
+  static constexpr size_t next_capacity(size_t capacity, size_t) noexcept {
+    return std::max({MinCapacity, capacity + 1, capacity / Den * Num + capacity % Den * Num / Den});
+  }
+};
+
+using double_growth = grow_by_factor<2>;
+
+// Adds Step elements at a time, starting from MinCapacity.
+template <size_t Step, size_t MinCapacity = Step>
+struct grow_by_step {
+  static_assert(Step != 0 && MinCapacity != 0, "growth must make room");
+
+  static constexpr bool overwrite = false;
+
+  static constexpr size_t next_capacity(size_t capacity, size_t) noexcept {
+    return std::max(MinCapacity, capacity + Step);
+  }
+};
+
+// Grows like Growth, then rounds the storage up to whole pages.
+template <typename Growth = double_growth, size_t PageSize = 4096>
+struct grow_to_pages {
+  static constexpr bool overwrite = false;
+
+  static constexpr size_t next_capacity(size_t capacity, size_t element_size) noexcept {
+    size_t bytes = Growth::next_capacity(capacity, element_size) * element_size;
+    return (bytes + PageSize - 1) / PageSize * PageSize / element_size;
+  }
+};
+
+// Never reallocates on push: a full buffer overwrites its oldest element,
+// so the capacity given at construction must be non-zero.
+struct fixed_capacity {
+  static constexpr bool overwrite = true;
+};
+
+// Stats policies: what the buffer records about its own use.
+
+// Records nothing and takes no space.
+struct no_stats {
+  static constexpr bool enabled = false;
+};
+
+// Plain counters, cheap to read and export. They belong to the object:
+// copies and moved-to buffers start from zero, and swap leaves them in place.
+struct buffer_stats {
+  static constexpr bool enabled = true;
+
+  size_t reallocations = 0;  // times the storage was replaced
+  size_t bytes_copied = 0;   // bytes of elements moved into new storage
+  size_t peak_size = 0;      // largest size() seen
+  size_t drops = 0;          // elements lost to overwrite mode
+  size_t wraps = 0;          // times writing at the back ran past the last slot
+};
+
+// Detects allocators that report the size they really handed out, as with
+// C++23 allocate_at_least returning {ptr, count}.
+template <typename A, typename = void>
+struct has_allocate_at_least : std::false_type {};
+
+template <typename A>
+struct has_allocate_at_least<A, std::void_t<decltype(std::declval<A&>().allocate_at_least(size_t()))>>
+    : std::true_type {};
+
+template <typename T, typename Allocator = std::allocator<T>, typename Index = modulo_index,
+          typename Growth = double_growth, typename Stats = no_stats>
+class circular_buffer : private Stats {
+  using alloc_traits = std::allocator_traits<Allocator>;
+
+  static_assert(std::is_same_v<typename alloc_traits::value_type, T>, "Allocator must allocate T");
+  static_assert(std::is_same_v<typename alloc_traits::pointer, T*>, "fancy pointers are not supported");
+
   T* data_;
   size_t capacity_;
   size_t head_;
   size_t size_;
+  Allocator alloc_;
+
+  // Elements this large put the next slot on another cache line more often
+  // than not, so push_back and pop_front prefetch it.
+  static constexpr bool prefetch_slots = sizeof(T) >= cache_line_size / 2;
 
+  // Points straight at its slot and wraps to the start of storage when it
+  // steps off the end, so access needs neither the buffer nor a modulo.
+  // offset_ is the logical position, used for ordering and distances.
   template <class I>
   struct buffer_iterator {
     using value_type = T;
@@ -22,29 +163,32 @@ class circular_buffer {
     using iterator_category = std::random_access_iterator_tag;
 
   private:
-    circular_buffer* buff_;
-    size_t offset_;
+    I* ptr_;
+    I* first_;
+    I* last_;
+    ptrdiff_t offset_;
 
     friend circular_buffer;
 
-    size_t get_real_index(size_t off) const noexcept {
-      return (offset_ + buff_->head_ + off) % buff_->capacity_;
-    }
-
-    buffer_iterator(circular_buffer* buff) noexcept : buff_(buff), offset_(0) {}
+    template <class J>
+    friend struct buffer_iterator;
 
   public:
     buffer_iterator() noexcept = default;
 
-    buffer_iterator(circular_buffer* buff, size_t offset) noexcept : buff_(buff), offset_(offset) {}
+    buffer_iterator(I* ptr, I* first, I* last, ptrdiff_t offset) noexcept
+        : ptr_(ptr), first_(first), last_(last), offset_(offset) {}
 
-    template <class J>
+    // iterator converts to const_iterator, never the other way.
+    template <class J, typename = std::enable_if_t<std::is_same_v<I, const J>>>
     buffer_iterator(const buffer_iterator<J>& other) noexcept
-        : buff_(const_cast<circular_buffer*>(other.buff_)),
-          offset_(other.offset_) {}
+        : ptr_(other.ptr_), first_(other.first_), last_(other.last_), offset_(other.offset_) {}
 
-    buffer_iterator& operator++() {
+    buffer_iterator& operator++() noexcept {
       ++offset_;
+      if (++ptr_ == last_) {
+        ptr_ = first_;
+      }
       return *this;
     }
 
@@ -56,6 +200,10 @@ class circular_buffer {
 
     buffer_iterator& operator--() noexcept {
       --offset_;
+      if (ptr_ == first_) {
+        ptr_ = last_;
+      }
+      --ptr_;
       return *this;
     }
 
@@ -65,12 +213,20 @@ class circular_buffer {
       return temp;
     }
 
+    // offset must stay within one capacity of the current slot.
     buffer_iterator operator+(ptrdiff_t offset) const noexcept {
-      return buffer_iterator(buff_, offset_ + offset);
+      ptrdiff_t capacity = last_ - first_;
+      ptrdiff_t index = (ptr_ - first_) + offset;
+      if (index >= capacity) {
+        index -= capacity;
+      } else if (index < 0) {
+        index += capacity;
+      }
+      return buffer_iterator(first_ + index, first_, last_, offset_ + offset);
     }
 
     friend buffer_iterator operator+(ptrdiff_t offset, buffer_iterator a) noexcept {
-      return buffer_iterator(a.buff_, a.offset_ + offset);
+      return a + offset;
     }
 
     buffer_iterator operator-(ptrdiff_t offset) const noexcept {
@@ -85,29 +241,26 @@ class circular_buffer {
       return *this = *this - offset;
     }
 
-    ptrdiff_t operator-(const buffer_iterator& other) const noexcept {
+    template <class J>
+    ptrdiff_t operator-(const buffer_iterator<J>& other) const noexcept {
       return offset_ - other.offset_;
     }
 
-    reference operator[](size_t offset) const noexcept {
-      return *(buff_->data() + get_real_index(offset));
+    reference operator[](ptrdiff_t offset) const noexcept {
+      return *(*this + offset);
     }
 
     reference operator*() const noexcept {
-      return *(buff_->data() + get_real_index(0));
+      return *ptr_;
     }
 
     pointer operator->() const noexcept {
-      return buff_->data() + get_real_index(0);
-    }
-
-    bool operator!=(const circular_buffer& other) const noexcept {
-      return !(*this == other);
+      return ptr_;
     }
 
     template <class J>
     bool operator==(const buffer_iterator<J>& other) const noexcept {
-      return buff_ == other.buff_ && offset_ == other.offset_;
+      return first_ == other.first_ && offset_ == other.offset_;
     }
 
     template <class J>
@@ -115,25 +268,30 @@ class circular_buffer {
       return !(*this == other);
     }
 
-    bool operator>(const buffer_iterator& other) const noexcept {
-      return buff_ == other.buff_ && offset_ > other.offset_;
+    template <class J>
+    bool operator<(const buffer_iterator<J>& other) const noexcept {
+      return offset_ < other.offset_;
     }
 
-    bool operator<(const buffer_iterator& other) const noexcept {
-      return !(*this == other || *this > other);
+    template <class J>
+    bool operator>(const buffer_iterator<J>& other) const noexcept {
+      return other < *this;
     }
 
-    bool operator>=(const buffer_iterator& other) const noexcept {
-      return *this > other || *this == other;
+    template <class J>
+    bool operator<=(const buffer_iterator<J>& other) const noexcept {
+      return !(other < *this);
     }
 
-    bool operator<=(const buffer_iterator& other) const noexcept {
-      return *this < other || *this == other;
+    template <class J>
+    bool operator>=(const buffer_iterator<J>& other) const noexcept {
+      return !(*this < other);
     }
   };
 
 public:
   using value_type = T;
+  using allocator_type = Allocator;
 
   using reference = T&;
   using const_reference = const T&;
@@ -147,26 +305,96 @@ public:
   using reverse_iterator = std::reverse_iterator<iterator>;
   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
+  // Contiguous run of storage: first slot and number of slots.
+  using array_range = std::pair<pointer, size_t>;
+  using const_array_range = std::pair<const_pointer, size_t>;
+
 public:
   // O(1), nothrow
-  circular_buffer() noexcept : data_(nullptr), capacity_(0), head_(0), size_(0) {}
+  // Not in overwrite mode, where the capacity must be given and non-zero.
+  template <typename G = Growth, std::enable_if_t<!G::overwrite, int> = 0>
+  circular_buffer() noexcept(noexcept(Allocator())) : circular_buffer(no_storage(), Allocator()) {}
+
+  // O(1), nothrow
+  // Not in overwrite mode, where the capacity must be given and non-zero.
+  template <typename G = Growth, std::enable_if_t<!G::overwrite, int> = 0>
+  explicit circular_buffer(const Allocator& alloc) noexcept : circular_buffer(no_storage(), alloc) {}
 
   // O(n), strong
-  circular_buffer(const circular_buffer& other) : circular_buffer(other, other.size_) {}
+  // Capacity may be rounded up by the index policy. Throws
+  // std::invalid_argument for a capacity of 0 in overwrite mode.
+  explicit circular_buffer(size_t capacity, const Allocator& alloc = Allocator()) : circular_buffer(no_storage(), alloc) {
+    if constexpr (Growth::overwrite) {
+      if (capacity == 0) {
+        throw std::invalid_argument("circular_buffer: overwrite mode needs a non-zero capacity");
+      }
+    }
+    reserve(capacity);
+  }
 
   // O(n), strong
+  circular_buffer(const circular_buffer& other)
+      : circular_buffer(other, copy_capacity(other), alloc_traits::select_on_container_copy_construction(other.alloc_)) {}
+
+  // O(1), nothrow
+  // A moved-from buffer has no storage, so in overwrite mode it must be
+  // assigned to before the next push.
+  circular_buffer(circular_buffer&& other) noexcept : circular_buffer(no_storage(), other.alloc_) {
+    swap_storage(other);
+  }
+
+  // O(n), strong
+  // Takes other's allocator when it propagates on copy assignment, and keeps
+  // this buffer's otherwise.
   circular_buffer& operator=(const circular_buffer& other) {
-    if (*this != other) {
-      circular_buffer tmp = circular_buffer(other);
-      swap(tmp, *this);
+    if (this != &other) {
+      constexpr bool propagate = alloc_traits::propagate_on_container_copy_assignment::value;
+      Allocator alloc = propagate ? other.alloc_ : alloc_;
+      circular_buffer tmp(other, copy_capacity(other), alloc);
+      swap_storage(tmp);
+      if constexpr (propagate) {
+        std::swap(alloc_, tmp.alloc_);
+      }
     }
     return *this;
   }
 
-  // O(n), nothrow
+  // O(n), nothrow when the allocator propagates or is always equal
+  // Otherwise, with unequal allocators, elements are moved one by one.
+  circular_buffer& operator=(circular_buffer&& other) noexcept(
+      alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value) {
+    if (this != &other) {
+      if constexpr (alloc_traits::propagate_on_container_move_assignment::value) {
+        circular_buffer tmp = circular_buffer(std::move(other));
+        swap_storage(tmp);
+        std::swap(alloc_, tmp.alloc_);
+      } else if (alloc_traits::is_always_equal::value || alloc_ == other.alloc_) {
+        circular_buffer tmp = circular_buffer(std::move(other));
+        swap_storage(tmp);
+      } else {
+        circular_buffer tmp(no_storage(), alloc_);
+        tmp.reserve(copy_capacity(other));
+        tmp.append(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+        swap_storage(tmp);
+      }
+    }
+    return *this;
+  }
+
+  // O(n), O(1) for trivially destructible T, nothrow
   ~circular_buffer() {
     clear();
-    operator delete(data());
+    deallocate(data(), capacity());
+  }
+
+  // O(1), nothrow
+  allocator_type get_allocator() const noexcept {
+    return alloc_;
+  }
+
+  // O(1), nothrow
+  const Stats& stats() const noexcept {
+    return *this;
   }
 
   pointer data() noexcept {
@@ -194,22 +422,22 @@ public:
 
   // O(1), nothrow
   iterator begin() noexcept {
-    return const_cast<circular_buffer*>(this);
+    return {data() + head_, data(), data() + capacity(), 0};
   }
 
   // O(1), nothrow
   const_iterator begin() const noexcept {
-    return const_cast<circular_buffer*>(this);
+    return {data() + head_, data(), data() + capacity(), 0};
   }
 
   // O(1), nothrow
   iterator end() noexcept {
-    return {const_cast<circular_buffer*>(this), size_};
+    return {data() + end_slot(), data(), data() + capacity(), static_cast<ptrdiff_t>(size_)};
   }
 
   // O(1), nothrow
   const_iterator end() const noexcept {
-    return {const_cast<circular_buffer*>(this), size_};
+    return {data() + end_slot(), data(), data() + capacity(), static_cast<ptrdiff_t>(size_)};
   }
 
   // O(1), nothrow
@@ -234,12 +462,12 @@ public:
 
   // O(1), nothrow
   T& operator[](size_t index) {
-    return data()[(head_ + index) % capacity_];
+    return data()[wrap(head_ + index)];
   }
 
   // O(1), nothrow
   const T& operator[](size_t index) const {
-    return data()[(head_ + index) % capacity_];
+    return data()[wrap(head_ + index)];
   }
 
   // O(1), nothrow
@@ -264,31 +492,80 @@ public:
 
   // O(1), strong
   void push_back(const T& val) {
+    emplace_back(val);
+  }
+
+  // O(1), strong
+  void push_back(T&& val) {
+    emplace_back(std::move(val));
+  }
+
+  // O(1), strong
+  void push_front(const T& val) {
+    emplace_front(val);
+  }
+
+  // O(1), strong
+  void push_front(T&& val) {
+    emplace_front(std::move(val));
+  }
+
+  // When full in overwrite mode, push_back and emplace_back replace front()
+  // and push_front and emplace_front replace back(), by assignment.
+
+  // O(1), strong
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
     if (size() == capacity()) {
-      ensure_capacity(capacity() == 0 ? 1 : capacity() * 2);
-      push_back(val);
-    } else {
-      new (data() + tail()) T(val);
-      ++size_;
+      if constexpr (Growth::overwrite) {
+        assert(capacity() != 0);
+        T& slot = data()[head_] = T(std::forward<Args>(args)...);
+        note_written(1);
+        note_dropped(1);
+        head_ = wrap(head_ + 1);
+        return slot;
+      } else {
+        return grow_and_emplace(size(), std::forward<Args>(args)...);
+      }
     }
+    T* slot = data() + tail();
+    alloc_traits::construct(alloc_, slot, std::forward<Args>(args)...);
+    if constexpr (prefetch_slots) {
+      prefetch<true>(slot + 1);
+    }
+    note_written(1);
+    ++size_;
+    note_size();
+    return *slot;
   }
 
   // O(1), strong
-  void push_front(const T& val) {
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
     if (size() == capacity()) {
-      ensure_capacity(capacity() == 0 ? 1 : capacity() * 2);
-      push_front(val);
-    } else {
-      size_t tmp = (head_ + capacity_ - 1) % capacity_;
-      new (data() + tmp) T(val);
-      head_ = tmp;
-      ++size_;
+      if constexpr (Growth::overwrite) {
+        assert(capacity() != 0);
+        size_t tmp = wrap(head_ + capacity_ - 1);
+        T& slot = data()[tmp] = T(std::forward<Args>(args)...);
+        note_dropped(1);
+        head_ = tmp;
+        return slot;
+      } else {
+        return grow_and_emplace(0, std::forward<Args>(args)...);
+      }
     }
+    size_t tmp = wrap(head_ + capacity_ - 1);
+    T* slot = data() + tmp;
+    alloc_traits::construct(alloc_, slot, std::forward<Args>(args)...);
+    head_ = tmp;
+    ++size_;
+    note_size();
+    return *slot;
   }
 
   // O(1), nothrow
   void pop_back() {
-    std::destroy_n(end() - 1, 1);
+    alloc_traits::destroy(alloc_, std::addressof(back()));
     --size_;
     // --size_;
     // data()[tail()].~T();
@@ -297,32 +574,314 @@ public:
   // O(1), nothrow
   void pop_front() {
     --size_;
-    data()[head_].~T();
-    head_ = (head_ + 1) % capacity_;
+    alloc_traits::destroy(alloc_, data() + head_);
+    head_ = wrap(head_ + 1);
+    if constexpr (prefetch_slots) {
+      prefetch(data() + head_);
+    }
+  }
+
+  // Live elements are array_one() followed by array_two();
+  // array_two() is empty unless the contents wrap around.
+
+  // O(1), nothrow
+  array_range array_one() noexcept {
+    return {data() + head_, first_run()};
+  }
+
+  // O(1), nothrow
+  const_array_range array_one() const noexcept {
+    return {data() + head_, first_run()};
+  }
+
+  // O(1), nothrow
+  array_range array_two() noexcept {
+    return {data(), size() - first_run()};
+  }
+
+  // O(1), nothrow
+  const_array_range array_two() const noexcept {
+    return {data(), size() - first_run()};
+  }
+
+  // Unused slots past back(), in order: free_array_one() then free_array_two().
+  // They hold no objects; after constructing elements there, call commit_back.
+
+  // O(1), nothrow
+  array_range free_array_one() noexcept {
+    if (capacity() == 0) {
+      return {data(), 0};
+    }
+    size_t start = tail();
+    return {data() + start, std::min(capacity() - size(), capacity() - start)};
+  }
+
+  // O(1), nothrow
+  array_range free_array_two() noexcept {
+    size_t first = free_array_one().second;
+    return {data(), capacity() - size() - first};
+  }
+
+  // O(1), nothrow
+  // Makes count elements already constructed in the free arrays part of the buffer.
+  void commit_back(size_t count) noexcept {
+    assert(count <= capacity() - size());
+    note_written(count);
+    size_ += count;
+    note_size();
+  }
+
+  // Bulk operations touch at most two contiguous runs and use memcpy
+  // for trivially copyable T. In overwrite mode append drops the oldest
+  // elements to make room and only gives the basic guarantee.
+
+  // O(n), strong
+  template <typename InputIt>
+  void append(InputIt first, InputIt last) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_trivially_copyable_v<T> && std::is_pointer_v<InputIt> &&
+                  std::is_same_v<std::remove_cv_t<std::remove_pointer_t<InputIt>>, T>) {
+      append_n(first, last - first);
+    } else if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+      size_t count = std::distance(first, last);
+      size_t fit = make_room(count);
+      std::advance(first, count - fit);
+      count = fit;
+      array_range one = free_array_one();
+      size_t head_part = std::min(count, one.second);
+      InputIt mid = construct_n(one.first, first, head_part);
+      try {
+        construct_n(data(), mid, count - head_part);
+      } catch (...) {
+        destroy_n(one.first, head_part);
+        throw;
+      }
+      commit_back(count);
+    } else {
+      size_t old_size = size();
+      try {
+        for (; first != last; ++first) {
+          emplace_back(*first);
+        }
+      } catch (...) {
+        consume_back(size() - old_size);
+        throw;
+      }
+    }
   }
 
   // O(n), strong
+  void append_n(const T* src, size_t count) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (count == 0) {
+        return;
+      }
+      size_t fit = make_room(count);
+      src += count - fit;
+      count = fit;
+      array_range one = free_array_one();
+      size_t head_part = std::min(count, one.second);
+      std::memcpy(one.first, src, head_part * sizeof(T));
+      std::memcpy(data(), src + head_part, (count - head_part) * sizeof(T));
+      commit_back(count);
+    } else {
+      append(src, src + count);
+    }
+  }
+
+  // O(n), nothrow
+  // Removes the first count elements; O(1) for trivially destructible T.
+  void consume_front(size_t count) noexcept {
+    assert(count <= size());
+    if (count == 0) {
+      return;
+    }
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      array_range one = array_one();
+      size_t head_part = std::min(count, one.second);
+      destroy_n(one.first, head_part);
+      destroy_n(data(), count - head_part);
+    }
+    head_ = wrap(head_ + count);
+    size_ -= count;
+  }
+
+  // O(n), nothrow
+  // Removes the last count elements; O(1) for trivially destructible T.
+  void consume_back(size_t count) noexcept {
+    assert(count <= size());
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      array_range two = array_two();
+      size_t tail_part = std::min(count, two.second);
+      destroy_n(two.first + two.second - tail_part, tail_part);
+      destroy_n(data() + head_ + first_run() - (count - tail_part), count - tail_part);
+    }
+    size_ -= count;
+  }
+
+  // O(n), basic
+  // Copies the first count elements to dst and returns the end of the output.
+  template <typename OutputIt>
+  OutputIt copy_out(OutputIt dst, size_t count) const {
+    assert(count <= size());
+    const_array_range one = array_one();
+    size_t head_part = std::min(count, one.second);
+    if constexpr (std::is_same_v<OutputIt, T*> && std::is_trivially_copyable_v<T>) {
+      if (count != 0) {
+        std::memcpy(dst, one.first, head_part * sizeof(T));
+        std::memcpy(dst + head_part, data(), (count - head_part) * sizeof(T));
+      }
+      return dst + count;
+    } else {
+      dst = std::copy_n(one.first, head_part, dst);
+      return std::copy_n(data(), count - head_part, dst);
+    }
+  }
+
+  // Batched access: f sees at most two contiguous runs as (pointer, count)
+  // and the buffer is updated once per run, not once per element.
+
+  // O(n), basic
+  // Calls f(pointer, count) on each run of the first count elements, which f
+  // may move from, then destroys them. Returns how many were consumed.
+  template <typename F>
+  size_t consume_up_to(size_t count, F&& f) {
+    count = std::min(count, size());
+    for (size_t left = count; left != 0;) {
+      size_t run = std::min(left, first_run());
+      f(data() + head_, run);
+      consume_front(run);
+      left -= run;
+    }
+    return count;
+  }
+
+  // O(n), basic
+  template <typename F>
+  size_t consume_all(F&& f) {
+    return consume_up_to(size(), std::forward<F>(f));
+  }
+
+  // O(n), basic
+  // Calls f(pointer, count) on runs of up to count free slots past back().
+  // f constructs elements in the leading slots of the run and returns how
+  // many; a short run ends the call. Returns how many elements were added.
+  // Grows the buffer if needed; in overwrite mode only the free slots are
+  // offered and nothing is dropped.
+  template <typename F>
+  size_t produce(size_t count, F&& f) {
+    if constexpr (Growth::overwrite) {
+      count = std::min(count, capacity() - size());
+    } else {
+      make_room(count);
+    }
+    size_t done = 0;
+    while (done != count) {
+      array_range run = free_array_one();
+      size_t wanted = std::min(count - done, run.second);
+      size_t built = f(run.first, wanted);
+      assert(built <= wanted);
+      commit_back(built);
+      done += built;
+      if (built != wanted) {
+        break;
+      }
+    }
+    return done;
+  }
+
+  // O(n), strong
+  // Capacity may be rounded up by the index policy.
   void reserve(size_t desired_capacity) {
     ensure_capacity(desired_capacity);
   }
 
+  // O(n), strong
+  // Releases unused capacity. Does nothing in overwrite mode, where the
+  // capacity is the ring size.
+  void shrink_to_fit() {
+    if constexpr (!Growth::overwrite) {
+      size_t fitted = Index::round_capacity(size());
+      if (fitted < capacity()) {
+        reallocate(fitted);
+      }
+    }
+  }
+
+  // O(1), nothrow
+  bool is_linearized() const noexcept {
+    return head_ == 0;
+  }
+
   // O(n), basic
-  iterator insert(const_iterator pos, const T& val) {
-    ptrdiff_t delta = pos - begin();
-    if (delta < size() / 2) {
-      push_front(val);
-      iterator spot = begin() + delta;
-      for (auto i = begin(); i < spot; i++) {
-        std::iter_swap(i, i + 1);
-      }
-      return spot;
+  // Moves the elements in place so that they start at data() and returns
+  // data(). Types whose move may throw are copied into new storage instead.
+  pointer linearize() {
+    if (head_ == 0) {
+      return data();
+    }
+    if constexpr (!std::is_nothrow_move_constructible_v<T> || !std::is_nothrow_move_assignable_v<T>) {
+      reallocate(capacity());
+    } else if (size() == capacity()) {
+      std::rotate(data(), data() + head_, data() + capacity());
+      head_ = 0;
+    } else {
+      size_t first = first_run();
+      size_t second = size() - first;
+      // Close the gap before head_, then swap the two runs if the contents wrapped.
+      shift_down(head_, second, first);
+      std::rotate(data(), data() + second, data() + size());
+      head_ = 0;
+    }
+    return data();
+  }
+
+  // O(min(k, n - k)), O(1) when full, basic
+  // Makes new_begin, k elements past begin(), the first element.
+  void rotate(const_iterator new_begin) {
+    size_t k = new_begin - begin();
+    if (size() == capacity()) {
+      head_ = capacity() == 0 ? 0 : wrap(head_ + k);
+    } else if (k <= size() - k) {
+      for (; k != 0; --k) {
+        emplace_back(std::move(front()));
+        pop_front();
+      }
     } else {
-      push_back(val);
-      iterator spot = begin() + delta;
-      for (auto i = end() - 1; i > spot; i--) {
-        std::iter_swap(i, i - 1);
+      for (k = size() - k; k != 0; --k) {
+        emplace_front(std::move(back()));
+        pop_back();
       }
-      return spot;
+    }
+  }
+
+  // Insertion shifts whichever side of pos is shorter, once, in contiguous
+  // chunks (memmove for trivially copyable T). In overwrite mode a full
+  // buffer drops elements from the front, like boost::circular_buffer.
+
+  // O(n), basic
+  iterator insert(const_iterator pos, const T& val) {
+    return insert(pos, 1, val);
+  }
+
+  // O(n), basic
+  iterator insert(const_iterator pos, size_t count, const T& val) {
+    T copy = val;
+    return insert_n(pos - begin(), count, repeat_iterator{std::addressof(copy)});
+  }
+
+  // O(n), basic
+  template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+      return insert_n(pos - begin(), std::distance(first, last), first);
+    } else {
+      // Buffered in a growing buffer, since in overwrite mode this one would
+      // drop elements before they reach the insertion.
+      circular_buffer<T, Allocator, Index> tmp(alloc_);
+      tmp.append(first, last);
+      return insert(pos, std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()));
     }
   }
 
@@ -333,41 +892,35 @@ public:
 
   // O(n), basic
   iterator erase(const_iterator first, const_iterator last) {
-    ptrdiff_t delta = last - first;
-    if (end() - last < size_ / 2) {
-      for (iterator i = first; i + delta < end(); i++) {
-        std::iter_swap(i, i + delta);
-      }
-      for (auto i = 0; i < delta; i++) {
-        pop_back();
-      }
-      return first;
-    } else if (delta != 0) {
-      ptrdiff_t diff = first - begin();
-      for (iterator i = last - 1; i >= begin() + delta; i--) {
-        std::iter_swap(i, i - delta);
-      }
-      for (auto i = 0; i < delta; i++) {
-        pop_front();
-      }
-      return begin() + diff;
+    size_t from = first - begin();
+    size_t count = last - first;
+    if (count == 0) {
+      return begin() + from;
+    }
+    if (size() - from - count < from) {
+      move_within(from + count, from, size() - from - count);
+      consume_back(count);
+    } else {
+      move_within(0, count, from);
+      consume_front(count);
     }
-    return first;
+    return begin() + from;
   }
 
-  // O(n), nothrow
+  // O(n), O(1) for trivially destructible T, nothrow
   void clear() noexcept {
-    while (!empty()) {
-      pop_back();
-    }
+    consume_back(size());
+    head_ = 0;
   }
 
   // O(1), nothrow
+  // Allocators are exchanged only if they propagate on swap; otherwise they
+  // must compare equal.
   friend void swap(circular_buffer& a, circular_buffer& b) noexcept {
-    std::swap(a.data_, b.data_);
-    std::swap(a.capacity_, b.capacity_);
-    std::swap(a.head_, b.head_);
-    std::swap(a.size_, b.size_);
+    if constexpr (alloc_traits::propagate_on_container_swap::value) {
+      std::swap(a.alloc_, b.alloc_);
+    }
+    a.swap_storage(b);
   }
 
   bool operator==(const circular_buffer& other) const {
@@ -379,28 +932,452 @@ public:
   }
 
 private:
+  // Forward iterator that yields the same value forever.
+  struct repeat_iterator {
+    using value_type = T;
+    using reference = const T&;
+    using pointer = const T*;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    const T* value;
+
+    reference operator*() const noexcept {
+      return *value;
+    }
+
+    repeat_iterator& operator++() noexcept {
+      return *this;
+    }
+
+    repeat_iterator operator++(int) noexcept {
+      return *this;
+    }
+  };
+
+  size_t wrap(size_t index) const noexcept {
+    return Index::wrap(index, capacity_);
+  }
+
+  // Makes room for count more elements with at most one reallocation, or in
+  // overwrite mode by dropping the oldest ones. Returns how many of the count
+  // elements fit; the caller keeps the last ones.
+  size_t make_room(size_t count) {
+    if constexpr (Growth::overwrite) {
+      size_t fit = std::min(count, capacity());
+      size_t free = capacity() - size();
+      if (free < fit) {
+        consume_front(fit - free);
+      }
+      note_dropped(count - std::min(fit, free));
+      count = fit;
+    } else if (capacity() - size() < count) {
+      ensure_capacity(std::max(size() + count, Growth::next_capacity(capacity(), sizeof(T))));
+    }
+    return count;
+  }
+
+  // Opens a gap of count slots at logical position delta and fills it from
+  // first. Every intermediate state is a valid buffer, for the basic guarantee.
+  template <typename ForwardIt>
+  iterator insert_n(size_t delta, size_t count, ForwardIt first) {
+    if constexpr (Growth::overwrite) {
+      size_t free = capacity() - size();
+      if (count > free) {
+        size_t dropped = std::min(count - free, delta);
+        consume_front(dropped);
+        delta -= dropped;
+        size_t skipped = count - free - dropped;
+        std::advance(first, skipped);
+        count -= skipped;
+        note_dropped(dropped + skipped);
+      }
+    } else if (capacity() - size() < count) {
+      ensure_capacity(std::max(size() + count, Growth::next_capacity(capacity(), sizeof(T))));
+    }
+    if (count == 0) {
+      return begin() + delta;
+    }
+
+    size_t before = delta;
+    size_t after = size() - delta;
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (before < after) {
+        head_ = wrap(head_ + capacity_ - count);
+        move_within(count, 0, before);
+      } else {
+        move_within(delta, delta + count, after);
+      }
+      size_ += count;
+      assign_at(delta, first, count);
+    } else if (before < after) {
+      // New front slots take old elements first, then values.
+      if (count > before) {
+        ForwardIt rest = construct_at(capacity_ - (count - before), first, count - before);
+        grow_front(count - before);
+        construct_at(capacity_ - before, std::make_move_iterator(begin() + (count - before)), before);
+        grow_front(before);
+        assign_at(count, rest, before);
+      } else {
+        construct_at(capacity_ - count, std::make_move_iterator(begin()), count);
+        grow_front(count);
+        move_within(2 * count, count, before - count);
+        assign_at(before, first, count);
+      }
+    } else {
+      // New back slots take values first, then old elements.
+      if (count > after) {
+        construct_at(size(), std::next(first, after), count - after);
+        size_ += count - after;
+        construct_at(size(), std::make_move_iterator(begin() + delta), after);
+        size_ += after;
+        assign_at(delta, first, after);
+      } else {
+        size_t old_size = size();
+        construct_at(old_size, std::make_move_iterator(begin() + (old_size - count)), count);
+        size_ += count;
+        move_within(delta, delta + count, after - count);
+        assign_at(delta, first, count);
+      }
+    }
+    note_size();
+    return begin() + delta;
+  }
+
+  // Counts a wrap when writing count slots past back() goes on from the last
+  // slot to the first. Call before size() grows.
+  void note_written(size_t count) noexcept {
+    if constexpr (Stats::enabled) {
+      if (head_ + size_ <= capacity_ && head_ + size_ + count > capacity_) {
+        ++Stats::wraps;
+      }
+    }
+  }
+
+  void note_size() noexcept {
+    if constexpr (Stats::enabled) {
+      Stats::peak_size = std::max(Stats::peak_size, size_);
+    }
+  }
+
+  void note_dropped(size_t count) noexcept {
+    if constexpr (Stats::enabled) {
+      Stats::drops += count;
+    }
+  }
+
+  // Call before adopt, while size() still counts the relocated elements.
+  void note_reallocation() noexcept {
+    if constexpr (Stats::enabled) {
+      ++Stats::reallocations;
+      Stats::bytes_copied += size_ * sizeof(T);
+    }
+  }
+
+  void grow_front(size_t count) noexcept {
+    head_ = wrap(head_ + capacity_ - count);
+    size_ += count;
+  }
+
+  // Like construct_n, but to is a logical position that may wrap around.
+  template <typename InputIt>
+  InputIt construct_at(size_t to, InputIt first, size_t count) {
+    size_t dst = wrap(head_ + to);
+    size_t head_part = std::min(count, capacity_ - dst);
+    InputIt mid = construct_n(data() + dst, first, head_part);
+    try {
+      return construct_n(data(), mid, count - head_part);
+    } catch (...) {
+      destroy_n(data() + dst, head_part);
+      throw;
+    }
+  }
+
+  // Copy-assigns count values from first to logical position to.
+  template <typename InputIt>
+  void assign_at(size_t to, InputIt first, size_t count) {
+    size_t dst = wrap(head_ + to);
+    size_t head_part = std::min(count, capacity_ - dst);
+    first = assign_n(data() + dst, first, head_part);
+    assign_n(data(), first, count - head_part);
+  }
+
+  template <typename InputIt>
+  InputIt assign_n(T* dst, InputIt first, size_t count) {
+    if constexpr (std::is_pointer_v<InputIt>) {
+      std::copy_n(first, count, dst);
+      return first + count;
+    } else {
+      for (size_t i = 0; i < count; ++i, ++first) {
+        dst[i] = *first;
+      }
+      return first;
+    }
+  }
+
+  // Move-assigns count elements from logical position from to logical
+  // position to, in contiguous chunks; the ranges may overlap.
+  void move_within(size_t from, size_t to, size_t count) {
+    if (to < from) {
+      while (count != 0) {
+        size_t src = wrap(head_ + from);
+        size_t dst = wrap(head_ + to);
+        size_t chunk = std::min({count, capacity_ - src, capacity_ - dst});
+        if constexpr (std::is_trivially_copyable_v<T>) {
+          std::memmove(data() + dst, data() + src, chunk * sizeof(T));
+        } else {
+          std::move(data() + src, data() + src + chunk, data() + dst);
+        }
+        from += chunk;
+        to += chunk;
+        count -= chunk;
+      }
+    } else if (from < to) {
+      while (count != 0) {
+        size_t src_end = wrap(head_ + from + count - 1) + 1;
+        size_t dst_end = wrap(head_ + to + count - 1) + 1;
+        size_t chunk = std::min({count, src_end, dst_end});
+        if constexpr (std::is_trivially_copyable_v<T>) {
+          std::memmove(data() + dst_end - chunk, data() + src_end - chunk, chunk * sizeof(T));
+        } else {
+          std::move_backward(data() + src_end - chunk, data() + src_end, data() + dst_end);
+        }
+        count -= chunk;
+      }
+    }
+  }
+
+  size_t end_slot() const noexcept {
+    return capacity() == 0 ? 0 : tail();
+  }
+
+  size_t first_run() const noexcept {
+    return std::min(size(), capacity() - head_);
+  }
+
   size_t tail() const {
-    return (head_ + size()) % capacity_;
+    return wrap(head_ + size());
   }
 
   void ensure_capacity(const size_t new_capacity) {
     if (capacity_ < new_capacity) {
-      circular_buffer tmp = circular_buffer(*this, new_capacity);
-      swap(tmp, *this);
+      reallocate(Index::round_capacity(new_capacity));
     }
   }
 
-  circular_buffer(const circular_buffer& other, size_t new_capacity)
-      : data_(new_capacity == 0 ? nullptr : static_cast<T*>(operator new(sizeof(T) * new_capacity))),
-        capacity_(new_capacity),
-        head_(0),
-        size_(other.size_) {
+  // Moves the elements into new storage of exactly new_capacity slots.
+  void reallocate(size_t new_capacity) {
+    T* storage = allocate_at_least(new_capacity);
     try {
+      relocate_to(storage);
+    } catch (...) {
+      deallocate(storage, new_capacity);
+      throw;
+    }
+    note_reallocation();
+    adopt(storage, new_capacity);
+  }
 
-      std::uninitialized_copy(other.begin(), other.end(), data_);
+  // Moves the count live slots at src down to dst < src, where the slots
+  // in [dst, src) hold no objects. T's moves must not throw.
+  void shift_down(size_t src, size_t dst, size_t count) noexcept {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      std::memmove(data() + dst, data() + src, count * sizeof(T));
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        if (dst + i < src) {
+          alloc_traits::construct(alloc_, data() + dst + i, std::move(data()[src + i]));
+        } else {
+          data()[dst + i] = std::move(data()[src + i]);
+        }
+      }
+      size_t stale = std::max(src, dst + count);
+      destroy_n(data() + stale, src + count - stale);
+    }
+  }
+
+  // Builds the new element before touching the old ones, so args may refer
+  // into this buffer. position is 0 for the front and size() for the back.
+  template <typename... Args>
+  T& grow_and_emplace(size_t position, Args&&... args) {
+    size_t new_capacity = Index::round_capacity(Growth::next_capacity(capacity(), sizeof(T)));
+    T* storage = allocate_at_least(new_capacity);
+    T* slot = storage + position;
+    try {
+      alloc_traits::construct(alloc_, slot, std::forward<Args>(args)...);
+    } catch (...) {
+      deallocate(storage, new_capacity);
+      throw;
+    }
+    try {
+      relocate_to(position == 0 ? storage + 1 : storage);
     } catch (...) {
-      operator delete(data_);
+      alloc_traits::destroy(alloc_, slot);
+      deallocate(storage, new_capacity);
       throw;
     }
+    note_reallocation();
+    adopt(storage, new_capacity);
+    ++size_;
+    note_size();
+    return *slot;
+  }
+
+  // Moves the elements into raw storage, or copies them when T's move may
+  // throw, so that a failure leaves this buffer untouched. Trivially
+  // copyable T takes two memcpy calls.
+  void relocate_to(T* storage) {
+    array_range one = array_one();
+    array_range two = array_two();
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      construct_n(storage, one.first, one.second);
+      construct_n(storage + one.second, two.first, two.second);
+    } else if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+      construct_n(storage, std::make_move_iterator(one.first), one.second);
+      try {
+        construct_n(storage + one.second, std::make_move_iterator(two.first), two.second);
+      } catch (...) {
+        destroy_n(storage, one.second);
+        throw;
+      }
+    } else {
+      construct_n(storage, one.first, one.second);
+      try {
+        construct_n(storage + one.second, two.first, two.second);
+      } catch (...) {
+        destroy_n(storage, one.second);
+        throw;
+      }
+    }
+  }
+
+  // Replaces the storage with one already holding size() elements from index 0.
+  void adopt(T* storage, size_t new_capacity) noexcept {
+    size_t count = size_;
+    clear();
+    deallocate(data(), capacity());
+    data_ = storage;
+    capacity_ = new_capacity;
+    head_ = 0;
+    size_ = count;
+  }
+
+  // Exchanges everything but the allocators.
+  void swap_storage(circular_buffer& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(head_, other.head_);
+    std::swap(size_, other.size_);
+  }
+
+  // Constructs count elements at dst from first through the allocator and
+  // returns the advanced source. Nothing is left constructed on failure.
+  // Trivially copyable T is copied with memcpy: allocator construct only adds
+  // behaviour for types that take an allocator, which are never trivial.
+  template <typename InputIt>
+  InputIt construct_n(T* dst, InputIt first, size_t count) {
+    if constexpr (std::is_trivially_copyable_v<T> && std::is_pointer_v<InputIt> &&
+                  std::is_same_v<std::remove_cv_t<std::remove_pointer_t<InputIt>>, T>) {
+      if (count != 0) {
+        std::memcpy(dst, first, count * sizeof(T));
+      }
+      return first + count;
+    } else {
+      size_t built = 0;
+      try {
+        for (; built < count; ++built, ++first) {
+          alloc_traits::construct(alloc_, dst + built, *first);
+        }
+      } catch (...) {
+        destroy_n(dst, built);
+        throw;
+      }
+      return first;
+    }
+  }
+
+  void destroy_n(T* first, size_t count) noexcept {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      for (size_t i = 0; i < count; ++i) {
+        alloc_traits::destroy(alloc_, first + i);
+      }
+    }
+  }
+
+  T* allocate(size_t capacity) {
+    return capacity == 0 ? nullptr : alloc_traits::allocate(alloc_, capacity);
+  }
+
+  // Like allocate, but takes any slack the allocator reports by raising
+  // capacity, as far as the index policy allows. Never in overwrite mode,
+  // where the capacity is the ring size.
+  T* allocate_at_least(size_t& capacity) {
+    if constexpr (has_allocate_at_least<Allocator>::value && !Growth::overwrite) {
+      if (capacity != 0) {
+        auto result = alloc_.allocate_at_least(capacity);
+        if (Index::round_capacity(result.count) == result.count) {
+          capacity = result.count;
+        }
+        return result.ptr;
+      }
+    }
+    return allocate(capacity);
+  }
+
+  void deallocate(T* storage, size_t capacity) noexcept {
+    if (storage != nullptr) {
+      alloc_traits::deallocate(alloc_, storage, capacity);
+    }
+  }
+
+  // A copy keeps the capacity in overwrite mode and is sized to fit otherwise.
+  static size_t copy_capacity(const circular_buffer& other) noexcept {
+    return Growth::overwrite ? other.capacity_ : Index::round_capacity(other.size_);
+  }
+
+  // Empty and without storage, in either mode.
+  struct no_storage {};
+
+  circular_buffer(no_storage, const Allocator& alloc) noexcept
+      : data_(nullptr), capacity_(0), head_(0), size_(0), alloc_(alloc) {}
+
+  circular_buffer(const circular_buffer& other, size_t new_capacity, const Allocator& alloc)
+      : data_(nullptr),
+        capacity_(0),
+        head_(0),
+        size_(0),
+        alloc_(alloc) {
+    data_ = allocate_at_least(new_capacity);
+    capacity_ = new_capacity;
+    const_array_range one = other.array_one();
+    const_array_range two = other.array_two();
+    try {
+      construct_n(data_, one.first, one.second);
+      try {
+        construct_n(data_ + one.second, two.first, two.second);
+      } catch (...) {
+        destroy_n(data_, one.second);
+        throw;
+      }
+    } catch (...) {
+      deallocate(data_, capacity_);
+      throw;
+    }
+    size_ = other.size_;
   }
 };
+
+// Capacity is always a power of two, so indexing needs no division.
+template <typename T, typename Allocator = std::allocator<T>>
+using circular_buffer_pow2 = circular_buffer<T, Allocator, pow2_index>;
+
+// Fixed capacity, overwrites the oldest element when full.
+template <typename T, typename Allocator = std::allocator<T>>
+using bounded_circular_buffer = circular_buffer<T, Allocator, modulo_index, fixed_capacity>;
+
+// circular_buffer drawing its storage from a std::pmr::memory_resource.
+// Names cannot be added to namespace std, so this lives in ::pmr.
+namespace pmr {
+template <typename T, typename Index = modulo_index, typename Growth = double_growth, typename Stats = no_stats>
+using circular_buffer = ::circular_buffer<T, std::pmr::polymorphic_allocator<T>, Index, Growth, Stats>;
+}
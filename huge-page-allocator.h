@@ -0,0 +1,176 @@
+#pragma once
+
+#ifndef __linux__
+#error "huge_page_allocator needs mmap, madvise and mbind (Linux)"
+#endif
+
+#include "circular-buffer.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <system_error>
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct huge_page_options {
+  // Map explicit huge pages, falling back to transparent ones when none are
+  // reserved. Storage is then a whole number of huge pages.
+  bool huge_pages = true;
+  size_t huge_page_size = size_t(2) << 20;
+  // Bind the storage to this NUMA node. With -1 each page lands on the node
+  // of the thread that touches it first.
+  int numa_node = -1;
+  // Touch every page at allocation, so that push never takes a page fault.
+  // Without a node, this puts the storage on the allocating thread's node.
+  bool prefault = false;
+};
+
+// Maps storage straight from the kernel for rings too large for the heap.
+// Any instance can release any storage, so allocators always compare equal,
+// but the options travel with the container. Reserve up front: growing
+// copies everything into a fresh mapping.
+template <typename T>
+class huge_page_allocator {
+  huge_page_options options_;
+
+  template <typename>
+  friend class huge_page_allocator;
+
+public:
+  using value_type = T;
+
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::true_type;
+
+  struct allocation_result {
+    T* ptr;
+    size_t count;
+  };
+
+  explicit huge_page_allocator(const huge_page_options& options = huge_page_options()) noexcept
+      : options_(options) {}
+
+  template <typename U>
+  huge_page_allocator(const huge_page_allocator<U>& other) noexcept : options_(other.options_) {}
+
+  const huge_page_options& options() const noexcept {
+    return options_;
+  }
+
+  T* allocate(size_t n) {
+    if (n > (std::numeric_limits<size_t>::max() - granularity()) / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    size_t bytes = mapping_size(n);
+    void* storage = MAP_FAILED;
+    if (options_.huge_pages) {
+      storage = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (storage == MAP_FAILED) {
+      storage = map_aligned(bytes);
+    }
+    if (options_.numa_node >= 0) {
+      bind(storage, bytes);
+    }
+    if (options_.prefault) {
+      touch(storage, bytes);
+    }
+    return static_cast<T*>(storage);
+  }
+
+  // The whole mapping is usable, so report every element that fits.
+  allocation_result allocate_at_least(size_t n) {
+    T* storage = allocate(n);
+    return {storage, mapping_size(n) / sizeof(T)};
+  }
+
+  // Any n from the requested count to the one allocate_at_least returned
+  // rounds to the same mapping.
+  void deallocate(T* p, size_t n) noexcept {
+    munmap(p, mapping_size(n));
+  }
+
+  friend bool operator==(const huge_page_allocator&, const huge_page_allocator&) noexcept {
+    return true;
+  }
+
+  friend bool operator!=(const huge_page_allocator&, const huge_page_allocator&) noexcept {
+    return false;
+  }
+
+private:
+  static size_t page_size() noexcept {
+    static const size_t result = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return result;
+  }
+
+  size_t granularity() const noexcept {
+    return options_.huge_pages ? options_.huge_page_size : page_size();
+  }
+
+  size_t mapping_size(size_t n) const noexcept {
+    size_t unit = granularity();
+    return (n * sizeof(T) + unit - 1) / unit * unit;
+  }
+
+  // Ordinary pages, aligned to a huge page when asked for so transparent
+  // huge pages can back them: over-map by one unit and trim both ends.
+  void* map_aligned(size_t bytes) const {
+    size_t slack = options_.huge_pages ? options_.huge_page_size : 0;
+    void* raw = mmap(nullptr, bytes + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    if (slack == 0) {
+      return raw;
+    }
+    char* first = static_cast<char*>(raw);
+    char* aligned = first + (slack - reinterpret_cast<uintptr_t>(first) % slack) % slack;
+    if (aligned != first) {
+      munmap(first, aligned - first);
+    }
+    munmap(aligned + bytes, first + slack - aligned);
+    madvise(aligned, bytes, MADV_HUGEPAGE);
+    return aligned;
+  }
+
+  void bind(void* storage, size_t bytes) const {
+    constexpr size_t bits = std::numeric_limits<unsigned long>::digits;
+    unsigned long nodes[1024 / bits] = {};
+    size_t node = static_cast<size_t>(options_.numa_node);
+    if (node >= 1024) {
+      munmap(storage, bytes);
+      throw std::system_error(EINVAL, std::generic_category(), "mbind");
+    }
+    nodes[node / bits] = 1UL << (node % bits);
+    // The kernel reads one bit less than maxnode says.
+    if (syscall(SYS_mbind, storage, bytes, MPOL_BIND, nodes, 1024 + 1, MPOL_MF_STRICT | MPOL_MF_MOVE) != 0) {
+      int error = errno;
+      munmap(storage, bytes);
+      throw std::system_error(error, std::generic_category(), "mbind");
+    }
+  }
+
+  static void touch(void* storage, size_t bytes) noexcept {
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(storage, bytes, MADV_POPULATE_WRITE) == 0) {
+      return;
+    }
+#endif
+    volatile char* first = static_cast<char*>(storage);
+    for (size_t i = 0; i < bytes; i += page_size()) {
+      first[i] = 0;
+    }
+  }
+};
+
+// circular_buffer on memory mapped by huge_page_allocator.
+template <typename T, typename Index = modulo_index>
+using huge_page_circular_buffer = circular_buffer<T, huge_page_allocator<T>, Index>;
@@ -0,0 +1,332 @@
+#pragma once
+
+#ifndef __linux__
+#error "mapped_circular_buffer needs mmap and msync (Linux)"
+#endif
+
+#include "circular-buffer.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Fixed-capacity ring kept in a file mapped with MAP_SHARED, for journals that
+// must survive a restart. The file starts with a one-page header followed by
+// the slots. Instead of head_ and size_, the header holds two positions that
+// only ever grow, begin and end: every operation stores just one of them,
+// after the slots it covers, so a process crash at any point leaves a
+// consistent ring, and reopening the file recovers it without a replay.
+// Those stores are ordered only in the page cache, which the kernel writes
+// back in any order, so they do not survive a power loss or kernel crash.
+// For that, sync() flushes the slots and then records begin and end as the
+// synced range, flushing the header after them. Reopening in the same boot
+// recovers the ring as it was last written; after a reboot, as of the last
+// sync(). One process may write at a time. Like bounded_circular_buffer, a
+// full ring overwrites its oldest record.
+template <typename T>
+class mapped_circular_buffer {
+  static_assert(std::is_trivially_copyable_v<T>, "records are stored as raw bytes");
+  static_assert(std::atomic<uint64_t>::is_always_lock_free, "the header is shared through the file");
+
+  struct header {
+    uint64_t magic;
+    uint64_t record_size;
+    uint64_t capacity;
+    std::atomic<uint64_t> begin;
+    std::atomic<uint64_t> end;
+    // Set by sync() only, and on disk once it returns.
+    std::atomic<uint64_t> synced_begin;
+    std::atomic<uint64_t> synced_end;
+    // Kernel boot that last opened the ring: begin and end are only valid
+    // while its page cache is.
+    char boot_id[40];
+  };
+
+  static constexpr uint64_t file_magic = 0x3150414d46554243;  // "CBUFMAP1"
+
+  header* header_;
+  T* data_;
+  size_t capacity_;
+  size_t header_size_;
+  size_t sync_every_;
+  size_t unsynced_;
+
+public:
+  using value_type = T;
+
+  using reference = T&;
+  using const_reference = const T&;
+
+  using pointer = T*;
+  using const_pointer = const T*;
+
+  using array_range = std::pair<pointer, size_t>;
+  using const_array_range = std::pair<const_pointer, size_t>;
+
+public:
+  // O(1), strong
+  // Opens the ring in path, creating it with room for capacity records if
+  // the file is empty or missing; an existing ring keeps its own capacity.
+  // With sync_every set, every sync_every records written call sync().
+  mapped_circular_buffer(const char* path, size_t capacity, size_t sync_every = 0)
+      : header_(nullptr),
+        data_(nullptr),
+        capacity_(0),
+        header_size_(static_cast<size_t>(sysconf(_SC_PAGESIZE))),
+        sync_every_(sync_every),
+        unsynced_(0) {
+    open_file(path, capacity);
+  }
+
+  mapped_circular_buffer(const mapped_circular_buffer&) = delete;
+  mapped_circular_buffer& operator=(const mapped_circular_buffer&) = delete;
+
+  // O(1), nothrow
+  // Unmapping does not flush: reopening in the same boot sees every record,
+  // but after a reboot only those as of the last sync().
+  ~mapped_circular_buffer() {
+    munmap(header_, header_size_ + capacity_ * sizeof(T));
+  }
+
+  // O(1), nothrow
+  size_t size() const noexcept {
+    return header_->end.load(std::memory_order_relaxed) - header_->begin.load(std::memory_order_relaxed);
+  }
+
+  // O(1), nothrow
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  // O(1), nothrow
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  // O(1), nothrow
+  const T& operator[](size_t index) const {
+    return data_[slot(header_->begin.load(std::memory_order_relaxed) + index)];
+  }
+
+  // O(1), nothrow
+  const T& front() const {
+    return (*this)[0];
+  }
+
+  // O(1), nothrow
+  const T& back() const {
+    return (*this)[size() - 1];
+  }
+
+  // O(1), basic
+  void push_back(const T& val) {
+    append_n(&val, 1);
+  }
+
+  // O(n), basic
+  // Drops the oldest records if needed, writes the new ones, then publishes
+  // them with a single store of end. Throws before changing the ring if the
+  // header cannot be flushed ahead of writing over synced records; a batched
+  // sync() can throw too, and the records are in the ring by then.
+  void append_n(const T* src, size_t count) {
+    if (count == 0) {
+      return;
+    }
+    if (count > capacity_) {
+      src += count - capacity_;
+      count = capacity_;
+    }
+    uint64_t end = header_->end.load(std::memory_order_relaxed);
+    protect_synced(end + count);
+    size_t free = capacity_ - size();
+    if (free < count) {
+      header_->begin.fetch_add(count - free, std::memory_order_release);
+    }
+    size_t dst = slot(end);
+    size_t head_part = std::min(count, capacity_ - dst);
+    std::memcpy(data_ + dst, src, head_part * sizeof(T));
+    std::memcpy(data_, src + head_part, (count - head_part) * sizeof(T));
+    header_->end.store(end + count, std::memory_order_release);
+    unsynced_ += count;
+    if (sync_every_ != 0 && unsynced_ >= sync_every_) {
+      sync();
+    }
+  }
+
+  // O(1), nothrow
+  void pop_front() noexcept {
+    consume_front(1);
+  }
+
+  // O(1), nothrow
+  void consume_front(size_t count) noexcept {
+    assert(count <= size());
+    header_->begin.fetch_add(count, std::memory_order_release);
+  }
+
+  // O(1), nothrow
+  void clear() noexcept {
+    header_->begin.store(header_->end.load(std::memory_order_relaxed), std::memory_order_release);
+  }
+
+  // Live records are array_one() followed by array_two().
+
+  // O(1), nothrow
+  const_array_range array_one() const noexcept {
+    size_t head = slot(header_->begin.load(std::memory_order_relaxed));
+    return {data_ + head, std::min(size(), capacity_ - head)};
+  }
+
+  // O(1), nothrow
+  const_array_range array_two() const noexcept {
+    return {data_, size() - array_one().second};
+  }
+
+  // Writes dirty slots back to the file, then makes the current ring the
+  // synced range and writes the header, waiting for both.
+  void sync() {
+    if (msync(data_, capacity_ * sizeof(T), MS_SYNC) == -1) {
+      fail("msync");
+    }
+    header_->synced_begin.store(header_->begin.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    header_->synced_end.store(header_->end.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    if (msync(header_, header_size_, MS_SYNC) == -1) {
+      fail("msync");
+    }
+    unsynced_ = 0;
+  }
+
+private:
+  size_t slot(uint64_t position) const noexcept {
+    return static_cast<size_t>(position % capacity_);
+  }
+
+  // Writing up to position end reuses the slots of the records before
+  // end - capacity_. Any of those in the synced range are dropped from it,
+  // together with an eighth of the ring more so that a full ring flushes the
+  // header only once per capacity_ / 8 records, and the header is flushed
+  // before the slots change. Throws when it cannot be, leaving the ring as
+  // it was.
+  void protect_synced(uint64_t end) {
+    uint64_t synced_begin = header_->synced_begin.load(std::memory_order_relaxed);
+    uint64_t synced_end = header_->synced_end.load(std::memory_order_relaxed);
+    if (synced_begin == synced_end || end <= synced_begin + capacity_) {
+      return;
+    }
+    header_->synced_begin.store(std::min(synced_end, end - capacity_ + capacity_ / 8), std::memory_order_relaxed);
+    if (msync(header_, header_size_, MS_SYNC) == -1) {
+      fail("msync");
+    }
+  }
+
+  // Empty when the kernel does not tell, which counts as another boot.
+  static void read_boot_id(char (&id)[40]) noexcept {
+    std::memset(id, 0, sizeof(id));
+    int fd = ::open("/proc/sys/kernel/random/boot_id", O_RDONLY | O_CLOEXEC);
+    if (fd != -1) {
+      if (read(fd, id, sizeof(id) - 1) == -1) {
+        id[0] = 0;
+      }
+      close(fd);
+    }
+  }
+
+  [[noreturn]] static void fail(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  [[noreturn]] static void reject(int fd, const char* what) {
+    close(fd);
+    throw std::system_error(std::make_error_code(std::errc::invalid_argument), what);
+  }
+
+  void open_file(const char* path, size_t capacity) {
+    int fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) {
+      fail("open");
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+      int error = errno;
+      close(fd);
+      errno = error;
+      fail("fstat");
+    }
+    // magic, record_size and capacity; a file without the magic was never
+    // finished and is started over.
+    uint64_t fields[3] = {};
+    if (st.st_size != 0 && pread(fd, fields, sizeof(fields), 0) != static_cast<ssize_t>(sizeof(fields))) {
+      reject(fd, "mapped_circular_buffer: not a ring of this record type");
+    }
+    bool fresh = fields[0] != file_magic;
+    if (fresh && st.st_size != 0 && fields[0] != 0) {
+      reject(fd, "mapped_circular_buffer: not a ring of this record type");
+    }
+    if (fresh) {
+      if (capacity == 0) {
+        reject(fd, "mapped_circular_buffer: capacity must be non-zero");
+      }
+      if (ftruncate(fd, static_cast<off_t>(header_size_ + capacity * sizeof(T))) == -1) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        fail("ftruncate");
+      }
+    } else {
+      if (fields[1] != sizeof(T) || fields[2] == 0 ||
+          static_cast<uint64_t>(st.st_size) != header_size_ + fields[2] * sizeof(T)) {
+        reject(fd, "mapped_circular_buffer: not a ring of this record type");
+      }
+      capacity = static_cast<size_t>(fields[2]);
+    }
+    size_t bytes = header_size_ + capacity * sizeof(T);
+    void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+      int error = errno;
+      close(fd);
+      errno = error;
+      fail("mmap");
+    }
+    close(fd);
+    header_ = static_cast<header*>(base);
+    data_ = reinterpret_cast<T*>(static_cast<char*>(base) + header_size_);
+    capacity_ = capacity;
+    char boot_id[40];
+    read_boot_id(boot_id);
+    if (fresh) {
+      header_->record_size = sizeof(T);
+      header_->capacity = capacity;
+      header_->begin.store(0, std::memory_order_relaxed);
+      header_->end.store(0, std::memory_order_relaxed);
+      header_->synced_begin.store(0, std::memory_order_relaxed);
+      header_->synced_end.store(0, std::memory_order_relaxed);
+      std::memcpy(header_->boot_id, boot_id, sizeof(boot_id));
+      // The magic goes last, so a crash during creation leaves no valid header.
+      std::atomic_thread_fence(std::memory_order_release);
+      header_->magic = file_magic;
+      return;
+    }
+    if (header_->synced_end.load() - header_->synced_begin.load() > capacity_) {
+      munmap(base, bytes);
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                              "mapped_circular_buffer: corrupt header");
+    }
+    if (boot_id[0] == 0 || std::memcmp(header_->boot_id, boot_id, sizeof(boot_id)) != 0) {
+      // Another boot: only the synced range is known to be on disk.
+      header_->begin.store(header_->synced_begin.load(), std::memory_order_relaxed);
+      header_->end.store(header_->synced_end.load(), std::memory_order_relaxed);
+      std::memcpy(header_->boot_id, boot_id, sizeof(boot_id));
+    } else if (header_->end.load() - header_->begin.load() > capacity_) {
+      munmap(base, bytes);
+      throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                              "mapped_circular_buffer: corrupt header");
+    }
+  }
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+#ifndef __linux__
+#error "mirrored_circular_buffer needs memfd_create and mmap (Linux)"
+#endif
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// circular_buffer whose storage is mapped twice, back to back, in virtual
+// memory: slot capacity() + i is slot i. Any run of up to capacity()
+// elements starting at head_ is therefore contiguous, iterators are plain
+// pointers and no access needs a modulo. Capacities are rounded up so that
+// the storage is a whole number of pages. Elements must be trivially
+// copyable, since the same object is visible at two addresses.
+template <typename T>
+class mirrored_circular_buffer {
+  static_assert(std::is_trivially_copyable_v<T>, "mirrored storage holds trivially copyable T only");
+
+  T* data_;
+  size_t capacity_;
+  size_t head_;
+  size_t size_;
+
+public:
+  using value_type = T;
+
+  using reference = T&;
+  using const_reference = const T&;
+
+  using pointer = T*;
+  using const_pointer = const T*;
+
+  using iterator = T*;
+  using const_iterator = const T*;
+
+public:
+  // O(1), nothrow
+  mirrored_circular_buffer() noexcept : data_(nullptr), capacity_(0), head_(0), size_(0) {}
+
+  // O(1), strong
+  // Capacity is rounded up to a whole number of pages.
+  explicit mirrored_circular_buffer(size_t capacity) : mirrored_circular_buffer() {
+    reserve(capacity);
+  }
+
+  // O(n), strong
+  mirrored_circular_buffer(const mirrored_circular_buffer& other) : mirrored_circular_buffer() {
+    reserve(other.size());
+    append_n(other.begin(), other.size());
+  }
+
+  // O(1), nothrow
+  mirrored_circular_buffer(mirrored_circular_buffer&& other) noexcept : mirrored_circular_buffer() {
+    swap(other, *this);
+  }
+
+  // O(n), strong
+  mirrored_circular_buffer& operator=(const mirrored_circular_buffer& other) {
+    if (this != &other) {
+      mirrored_circular_buffer tmp(other);
+      swap(tmp, *this);
+    }
+    return *this;
+  }
+
+  // O(1), nothrow
+  mirrored_circular_buffer& operator=(mirrored_circular_buffer&& other) noexcept {
+    if (this != &other) {
+      mirrored_circular_buffer tmp(std::move(other));
+      swap(tmp, *this);
+    }
+    return *this;
+  }
+
+  // O(1), nothrow
+  ~mirrored_circular_buffer() {
+    unmap(data_, capacity_);
+  }
+
+  // First slot of the primary mapping; the mirror follows at data() + capacity().
+  pointer data() noexcept {
+    return data_;
+  }
+
+  const_pointer data() const noexcept {
+    return data_;
+  }
+
+  // O(1), nothrow
+  size_t size() const noexcept {
+    return size_;
+  }
+
+  // O(1), nothrow
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  // O(1), nothrow
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  // O(1), nothrow
+  iterator begin() noexcept {
+    return data_ + head_;
+  }
+
+  // O(1), nothrow
+  const_iterator begin() const noexcept {
+    return data_ + head_;
+  }
+
+  // O(1), nothrow
+  iterator end() noexcept {
+    return begin() + size_;
+  }
+
+  // O(1), nothrow
+  const_iterator end() const noexcept {
+    return begin() + size_;
+  }
+
+  // O(1), nothrow
+  T& operator[](size_t index) {
+    return begin()[index];
+  }
+
+  // O(1), nothrow
+  const T& operator[](size_t index) const {
+    return begin()[index];
+  }
+
+  // O(1), nothrow
+  T& back() {
+    return end()[-1];
+  }
+
+  // O(1), nothrow
+  const T& back() const {
+    return end()[-1];
+  }
+
+  // O(1), nothrow
+  T& front() {
+    return *begin();
+  }
+
+  // O(1), nothrow
+  const T& front() const {
+    return *begin();
+  }
+
+  // O(1), strong
+  void push_back(const T& val) {
+    if (size() == capacity()) {
+      T copy = val;
+      ensure_capacity(capacity() + 1);
+      *end() = copy;
+    } else {
+      *end() = val;
+    }
+    ++size_;
+  }
+
+  // O(1), strong
+  void push_front(const T& val) {
+    if (size() == capacity()) {
+      T copy = val;
+      ensure_capacity(capacity() + 1);
+      push_front(copy);
+      return;
+    }
+    head_ = head_ == 0 ? capacity_ - 1 : head_ - 1;
+    *begin() = val;
+    ++size_;
+  }
+
+  // O(1), nothrow
+  void pop_back() {
+    --size_;
+  }
+
+  // O(1), nothrow
+  void pop_front() {
+    --size_;
+    head_ = head_ + 1 == capacity_ ? 0 : head_ + 1;
+  }
+
+  // O(n), strong
+  void append_n(const T* src, size_t count) {
+    if (capacity() - size() < count) {
+      ensure_capacity(size() + count);
+    }
+    if (count != 0) {
+      std::memmove(end(), src, count * sizeof(T));
+    }
+    size_ += count;
+  }
+
+  // O(1), nothrow
+  void consume_front(size_t count) noexcept {
+    head_ += count;
+    if (head_ >= capacity_) {
+      head_ -= capacity_;
+    }
+    size_ -= count;
+  }
+
+  // O(1), nothrow
+  // The capacity() - size() unused slots, contiguous from end().
+  // After writing elements there, call commit_back.
+  pointer free_begin() noexcept {
+    return end();
+  }
+
+  // O(1), nothrow
+  void commit_back(size_t count) noexcept {
+    size_ += count;
+  }
+
+  // O(n), strong
+  void reserve(size_t desired_capacity) {
+    ensure_capacity(desired_capacity);
+  }
+
+  // O(1), nothrow
+  void clear() noexcept {
+    head_ = 0;
+    size_ = 0;
+  }
+
+  // O(1), nothrow
+  friend void swap(mirrored_circular_buffer& a, mirrored_circular_buffer& b) noexcept {
+    std::swap(a.data_, b.data_);
+    std::swap(a.capacity_, b.capacity_);
+    std::swap(a.head_, b.head_);
+    std::swap(a.size_, b.size_);
+  }
+
+private:
+  // Grows at least geometrically so that push_back stays amortized O(1).
+  void ensure_capacity(size_t new_capacity) {
+    if (capacity_ < new_capacity) {
+      size_t rounded = round_capacity(std::max(new_capacity, capacity_ * 2));
+      T* storage = map(rounded);
+      if (size_ != 0) {
+        std::memcpy(storage, begin(), size_ * sizeof(T));
+      }
+      unmap(data_, capacity_);
+      data_ = storage;
+      capacity_ = rounded;
+      head_ = 0;
+    }
+  }
+
+  static size_t round_capacity(size_t capacity) {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t step = page / std::gcd(page, sizeof(T));
+    return (capacity + step - 1) / step * step;
+  }
+
+  [[noreturn]] static void fail(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+
+  // Reserves twice the bytes of address space, then maps one memfd over
+  // both halves.
+  static T* map(size_t capacity) {
+    size_t bytes = capacity * sizeof(T);
+    int fd = memfd_create("mirrored_circular_buffer", MFD_CLOEXEC);
+    if (fd == -1) {
+      fail("memfd_create");
+    }
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == -1) {
+      int error = errno;
+      close(fd);
+      errno = error;
+      fail("ftruncate");
+    }
+    void* base = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+      int error = errno;
+      close(fd);
+      errno = error;
+      fail("mmap");
+    }
+    char* first = static_cast<char*>(base);
+    if (mmap(first, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(first + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+      int error = errno;
+      munmap(base, 2 * bytes);
+      close(fd);
+      errno = error;
+      fail("mmap");
+    }
+    close(fd);
+    return static_cast<T*>(base);
+  }
+
+  static void unmap(T* storage, size_t capacity) noexcept {
+    if (storage != nullptr) {
+      munmap(storage, 2 * capacity * sizeof(T));
+    }
+  }
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+// Bounded lock-free ring for any number of producer and consumer threads.
+// Every slot carries a sequence number (D. Vyukov's scheme): a slot at
+// position p is free for the producer that claims p while its sequence is p,
+// and holds a value for the consumer that claims p while it is p + 1.
+// Claiming a position is a single CAS on tail_ or head_.
+template <typename T>
+class mpmc_circular_buffer {
+  static_assert(std::is_nothrow_move_constructible_v<T>,
+                "a claimed slot must always be filled, so moving T must not throw");
+
+  struct slot {
+    std::atomic<size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T* value() noexcept {
+      return std::launder(reinterpret_cast<T*>(storage));
+    }
+  };
+
+  slot* data_;
+  size_t capacity_;
+
+  alignas(cache_line_size) std::atomic<size_t> tail_;
+  alignas(cache_line_size) std::atomic<size_t> head_;
+
+public:
+  using value_type = T;
+
+  // O(n), strong
+  // Capacity is rounded up to a power of two, and is at least 2.
+  explicit mpmc_circular_buffer(size_t capacity)
+      : data_(nullptr),
+        capacity_(pow2_index::round_capacity(std::max<size_t>(capacity, 2))),
+        tail_(0),
+        head_(0) {
+    data_ = static_cast<slot*>(operator new(sizeof(slot) * capacity_, std::align_val_t(alignof(slot))));
+    for (size_t i = 0; i < capacity_; ++i) {
+      new (&data_[i].sequence) std::atomic<size_t>(i);
+    }
+  }
+
+  mpmc_circular_buffer(const mpmc_circular_buffer&) = delete;
+  mpmc_circular_buffer& operator=(const mpmc_circular_buffer&) = delete;
+
+  // O(n), nothrow
+  ~mpmc_circular_buffer() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    for (size_t head = head_.load(std::memory_order_relaxed); head != tail; ++head) {
+      at(head).value()->~T();
+    }
+    operator delete(data_, std::align_val_t(alignof(slot)));
+  }
+
+  // O(1), nothrow
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  // O(1), nothrow
+  // Only a snapshot while other threads are pushing or popping.
+  size_t size() const noexcept {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  // O(1), nothrow
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  // O(1), strong
+  bool try_push(const T& val) {
+    return try_emplace(val);
+  }
+
+  // O(1), strong
+  bool try_push(T&& val) {
+    return try_emplace(std::move(val));
+  }
+
+  // O(1), strong
+  // Returns false when the ring is full. If constructing T may throw, the
+  // value is built before a slot is claimed and then moved in.
+  template <typename... Args>
+  bool try_emplace(Args&&... args) {
+    if constexpr (std::is_nothrow_constructible_v<T, Args&&...>) {
+      slot* s = claim_push();
+      if (s == nullptr) {
+        return false;
+      }
+      new (s->storage) T(std::forward<Args>(args)...);
+      publish_push(s);
+      return true;
+    } else {
+      T tmp(std::forward<Args>(args)...);
+      return try_emplace(std::move(tmp));
+    }
+  }
+
+  // O(1), nothrow
+  // Returns false and leaves out untouched when the ring is empty.
+  bool try_pop(T& out) noexcept {
+    static_assert(std::is_nothrow_move_assignable_v<T>,
+                  "a claimed slot must always be drained, so assigning T must not throw");
+    size_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      slot& s = at(pos);
+      size_t seq = s.sequence.load(std::memory_order_acquire);
+      std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          T* value = s.value();
+          out = std::move(*value);
+          value->~T();
+          s.sequence.store(pos + capacity_, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  slot& at(size_t pos) const noexcept {
+    return data_[pow2_index::wrap(pos, capacity_)];
+  }
+
+  slot* claim_push() noexcept {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      slot& s = at(pos);
+      size_t seq = s.sequence.load(std::memory_order_acquire);
+      std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          return &s;
+        }
+      } else if (diff < 0) {
+        return nullptr;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void publish_push(slot* s) noexcept {
+    size_t pos = s->sequence.load(std::memory_order_relaxed);
+    s->sequence.store(pos + 1, std::memory_order_release);
+  }
+};
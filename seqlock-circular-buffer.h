@@ -0,0 +1,152 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Fixed-capacity overwriting ring with one writer thread and any number of
+// reader threads that look at it through snapshots instead of copies. Slots
+// are addressed by positions that only grow; the writer claims a position
+// before overwriting its slot and publishes it afterwards, like a seqlock
+// per slot. A reader copies a slot out and then checks that no claim has
+// reached it since, so torn or overwritten elements are detected, never
+// returned. Slots are stored as relaxed atomic words, which keeps the
+// racing copies well defined.
+template <typename T>
+class seqlock_circular_buffer {
+  static_assert(std::is_trivially_copyable_v<T>, "readers copy slots as raw words");
+
+  static constexpr size_t slot_words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  std::atomic<uint64_t>* words_;
+  size_t capacity_;
+
+  alignas(cache_line_size) std::atomic<uint64_t> claimed_;
+  std::atomic<uint64_t> published_;
+
+public:
+  using value_type = T;
+
+  // Consistent view of the elements published when it was taken. Reading
+  // is wait-free; an element the writer has reached since reads as torn.
+  class snapshot {
+    const seqlock_circular_buffer* ring_;
+    uint64_t begin_;
+    uint64_t end_;
+
+    friend seqlock_circular_buffer;
+
+    snapshot(const seqlock_circular_buffer* ring, uint64_t begin, uint64_t end) noexcept
+        : ring_(ring), begin_(begin), end_(end) {}
+
+  public:
+    // O(1), nothrow
+    size_t size() const noexcept {
+      return static_cast<size_t>(end_ - begin_);
+    }
+
+    // O(1), nothrow
+    bool empty() const noexcept {
+      return size() == 0;
+    }
+
+    // O(1), nothrow
+    // Copies element index, oldest first, to out. Returns false, leaving
+    // out unspecified, if the writer has overwritten or is overwriting it.
+    bool read(size_t index, T& out) const noexcept {
+      assert(index < size());
+      return ring_->read(begin_ + index, out);
+    }
+
+    // O(1), nothrow
+    // Whether no element of the snapshot has been overwritten yet.
+    bool intact() const noexcept {
+      return !ring_->overwritten(begin_);
+    }
+
+    // O(n), nothrow if f is
+    // Calls f with a copy of each element, oldest first, and stops at the
+    // first torn one. Overwriting goes oldest first too, so everything after
+    // it is newer and a fresh snapshot picks up from there. Returns how many
+    // elements f saw.
+    template <typename F>
+    size_t for_each(F&& f) const {
+      T value;
+      for (size_t i = 0; i < size(); ++i) {
+        if (!read(i, value)) {
+          return i;
+        }
+        f(static_cast<const T&>(value));
+      }
+      return size();
+    }
+  };
+
+  // O(n), strong
+  // Capacity is rounded up to a power of two.
+  explicit seqlock_circular_buffer(size_t capacity)
+      : words_(nullptr), capacity_(pow2_index::round_capacity(std::max<size_t>(capacity, 1))), claimed_(0), published_(0) {
+    words_ = new std::atomic<uint64_t>[capacity_ * slot_words]();
+  }
+
+  seqlock_circular_buffer(const seqlock_circular_buffer&) = delete;
+  seqlock_circular_buffer& operator=(const seqlock_circular_buffer&) = delete;
+
+  // O(1), nothrow
+  ~seqlock_circular_buffer() {
+    delete[] words_;
+  }
+
+  // O(1), nothrow
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  // O(1), nothrow
+  size_t size() const noexcept {
+    return static_cast<size_t>(std::min<uint64_t>(published_.load(std::memory_order_acquire), capacity_));
+  }
+
+  // O(1), nothrow
+  // Writer thread only. When full, overwrites the oldest element.
+  void push_back(const T& val) noexcept {
+    uint64_t position = published_.load(std::memory_order_relaxed);
+    uint64_t words[slot_words] = {};
+    std::memcpy(words, &val, sizeof(T));
+    claimed_.store(position + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::atomic<uint64_t>* slot = words_ + pow2_index::wrap(position, capacity_) * slot_words;
+    for (size_t i = 0; i < slot_words; ++i) {
+      slot[i].store(words[i], std::memory_order_relaxed);
+    }
+    published_.store(position + 1, std::memory_order_release);
+  }
+
+  // O(1), nothrow
+  // Any thread. The snapshot holds the last capacity() published elements.
+  snapshot view() const noexcept {
+    uint64_t end = published_.load(std::memory_order_acquire);
+    return snapshot(this, end - std::min<uint64_t>(end, capacity_), end);
+  }
+
+private:
+  // A slot holds position until the writer claims position + capacity().
+  bool overwritten(uint64_t position) const noexcept {
+    return claimed_.load(std::memory_order_relaxed) > position + capacity_;
+  }
+
+  bool read(uint64_t position, T& out) const noexcept {
+    uint64_t words[slot_words];
+    const std::atomic<uint64_t>* slot = words_ + pow2_index::wrap(position, capacity_) * slot_words;
+    for (size_t i = 0; i < slot_words; ++i) {
+      words[i] = slot[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (overwritten(position)) {
+      return false;
+    }
+    std::memcpy(&out, words, sizeof(T));
+    return true;
+  }
+};
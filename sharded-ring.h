@@ -0,0 +1,266 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+
+// A set of fixed-capacity rings, one per producer thread (or core), for
+// tracing and logging where a single shared buffer would be the contention
+// point. A producer only ever writes its own shard: pushing is a relaxed load
+// and a release store of its tail, with no read-modify-write and no lock, and
+// each shard's indices and slots sit on cache lines of their own. Any number
+// of drainer threads take whole segments, everything published in a shard so
+// far, holding that shard's drain flag meanwhile; a drainer whose own shard is
+// empty steals the segment of the fullest other one. drain_ordered merges all
+// shards by a key such as a sequence number or timestamp.
+template <typename T>
+class sharded_ring {
+  struct shard {
+    T* data = nullptr;
+
+    // Written by the owning producer only.
+    alignas(cache_line_size) std::atomic<size_t> tail{0};
+    size_t cached_head = 0;
+
+    // Written by the drainer holding the shard.
+    alignas(cache_line_size) std::atomic<size_t> head{0};
+    std::atomic<bool> draining{false};
+  };
+
+  struct cursor {
+    size_t position;
+    size_t end;
+    shard* owner;
+  };
+
+  shard* shards_;
+  size_t shard_count_;
+  size_t capacity_;
+  std::vector<cursor> merge_;
+
+public:
+  using value_type = T;
+
+  // O(shards), strong
+  // Capacity per shard is rounded up to a power of two.
+  sharded_ring(size_t shard_count, size_t capacity)
+      : shards_(nullptr), shard_count_(shard_count), capacity_(pow2_index::round_capacity(std::max<size_t>(capacity, 1))) {
+    assert(shard_count != 0);
+    merge_.reserve(shard_count_);
+    shards_ = new shard[shard_count_];
+    try {
+      for (size_t i = 0; i < shard_count_; ++i) {
+        shards_[i].data = static_cast<T*>(operator new(storage_bytes(), std::align_val_t(cache_line_size)));
+      }
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+
+  sharded_ring(const sharded_ring&) = delete;
+  sharded_ring& operator=(const sharded_ring&) = delete;
+
+  // O(n), nothrow
+  ~sharded_ring() {
+    for (size_t i = 0; i < shard_count_; ++i) {
+      shard& s = shards_[i];
+      size_t tail = s.tail.load(std::memory_order_relaxed);
+      for (size_t head = s.head.load(std::memory_order_relaxed); head != tail; ++head) {
+        slot(s, head)->~T();
+      }
+    }
+    release();
+  }
+
+  // O(1), nothrow
+  size_t shard_count() const noexcept {
+    return shard_count_;
+  }
+
+  // O(1), nothrow
+  // Capacity of each shard.
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  // O(1), nothrow
+  // Exact only when neither the producer nor a drainer of the shard is running.
+  size_t size(size_t index) const noexcept {
+    const shard& s = shards_[index];
+    return s.tail.load(std::memory_order_acquire) - s.head.load(std::memory_order_acquire);
+  }
+
+  // Producer side: shard index belongs to one producer thread at a time.
+
+  // O(1), strong
+  bool try_push(size_t index, const T& val) {
+    return try_emplace(index, val);
+  }
+
+  // O(1), strong
+  bool try_push(size_t index, T&& val) {
+    return try_emplace(index, std::move(val));
+  }
+
+  // O(1), strong
+  // Returns false without constructing anything when the shard is full.
+  template <typename... Args>
+  bool try_emplace(size_t index, Args&&... args) {
+    shard& s = shards_[index];
+    size_t tail = s.tail.load(std::memory_order_relaxed);
+    if (tail - s.cached_head == capacity_) {
+      s.cached_head = s.head.load(std::memory_order_acquire);
+      if (tail - s.cached_head == capacity_) {
+        return false;
+      }
+    }
+    new (slot(s, tail)) T(std::forward<Args>(args)...);
+    s.tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Drain side: any thread, any number of them. f(pointer, count) sees each
+  // segment as at most two contiguous runs, may move from them, and the
+  // elements are destroyed after it returns.
+
+  // O(n), basic
+  // Drains the segment of shard home, or, when it is empty or held by another
+  // drainer, steals the segment of the fullest other shard. Returns how many
+  // elements f saw; 0 when there was nothing to take.
+  template <typename F>
+  size_t drain(size_t home, F&& f) {
+    if (size_t count = try_drain(shards_[home], f)) {
+      return count;
+    }
+    size_t victim = home;
+    size_t most = 0;
+    for (size_t i = 0; i < shard_count_; ++i) {
+      size_t pending = size(i);
+      if (i != home && pending > most) {
+        victim = i;
+        most = pending;
+      }
+    }
+    return most == 0 ? 0 : try_drain(shards_[victim], f);
+  }
+
+  // O(n), basic
+  // Drains every shard once, skipping those held by other drainers.
+  template <typename F>
+  size_t drain_all(F&& f) {
+    size_t count = 0;
+    for (size_t i = 0; i < shard_count_; ++i) {
+      count += try_drain(shards_[i], f);
+    }
+    return count;
+  }
+
+  // O(n log shards), basic
+  // Waits for every shard, then calls f(T&) on all published elements in
+  // ascending key(const T&), merging the shards' segments. Each producer must
+  // push with non-decreasing keys; the order holds within one call, since a
+  // shard may publish smaller keys than another's after the call has begun.
+  template <typename Key, typename F>
+  size_t drain_ordered(Key key, F&& f) {
+    for (size_t i = 0; i < shard_count_; ++i) {
+      while (shards_[i].draining.exchange(true, std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+    }
+    auto later = [&](const cursor& a, const cursor& b) {
+      return key(static_cast<const T&>(*slot(*b.owner, b.position))) <
+             key(static_cast<const T&>(*slot(*a.owner, a.position)));
+    };
+    size_t count = 0;
+    try {
+      for (size_t i = 0; i < shard_count_; ++i) {
+        shard& s = shards_[i];
+        cursor c = {s.head.load(std::memory_order_relaxed), s.tail.load(std::memory_order_acquire), &s};
+        if (c.position != c.end) {
+          merge_.push_back(c);
+        }
+      }
+      std::make_heap(merge_.begin(), merge_.end(), later);
+      while (!merge_.empty()) {
+        std::pop_heap(merge_.begin(), merge_.end(), later);
+        cursor& c = merge_.back();
+        T* value = slot(*c.owner, c.position);
+        f(*value);
+        value->~T();
+        ++count;
+        if (++c.position == c.end) {
+          c.owner->head.store(c.position, std::memory_order_release);
+          merge_.pop_back();
+        } else {
+          std::push_heap(merge_.begin(), merge_.end(), later);
+        }
+      }
+    } catch (...) {
+      finish_ordered();
+      throw;
+    }
+    finish_ordered();
+    return count;
+  }
+
+private:
+  size_t storage_bytes() const noexcept {
+    // Whole cache lines, so no two shards' slots share one.
+    return (sizeof(T) * capacity_ + cache_line_size - 1) / cache_line_size * cache_line_size;
+  }
+
+  T* slot(const shard& s, size_t index) const noexcept {
+    return s.data + pow2_index::wrap(index, capacity_);
+  }
+
+  void release() noexcept {
+    for (size_t i = 0; i < shard_count_; ++i) {
+      if (shards_[i].data != nullptr) {
+        operator delete(shards_[i].data, std::align_val_t(cache_line_size));
+      }
+    }
+    delete[] shards_;
+  }
+
+  // Consumes the shard's segment run by run, publishing the new head after
+  // each, so a throwing f leaves only its own run behind.
+  template <typename F>
+  size_t try_drain(shard& s, F& f) {
+    if (s.tail.load(std::memory_order_relaxed) == s.head.load(std::memory_order_relaxed) ||
+        s.draining.exchange(true, std::memory_order_acquire)) {
+      return 0;
+    }
+    struct unlock {
+      shard& s;
+      ~unlock() {
+        s.draining.store(false, std::memory_order_release);
+      }
+    } guard{s};
+    size_t begin = s.head.load(std::memory_order_relaxed);
+    size_t tail = s.tail.load(std::memory_order_acquire);
+    for (size_t head = begin; head != tail;) {
+      T* first = slot(s, head);
+      size_t run = std::min(tail - head, capacity_ - pow2_index::wrap(head, capacity_));
+      f(first, run);
+      std::destroy_n(first, run);
+      head += run;
+      s.head.store(head, std::memory_order_release);
+    }
+    return tail - begin;
+  }
+
+  // Publishes how far each shard was merged and lets other drainers in.
+  void finish_ordered() noexcept {
+    for (const cursor& c : merge_) {
+      c.owner->head.store(c.position, std::memory_order_release);
+    }
+    merge_.clear();
+    for (size_t i = 0; i < shard_count_; ++i) {
+      shards_[i].draining.store(false, std::memory_order_release);
+    }
+  }
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <functional>
+
+// Aggregates for sliding_window. Each sees every sample twice: push when it
+// enters the window and evict when it leaves, oldest first, and answers
+// value() in O(1).
+
+// Running total. Floating-point totals pick up rounding error over time,
+// since evicted samples are subtracted rather than re-added from scratch.
+template <typename T>
+struct window_sum {
+  T total = T();
+
+  explicit window_sum(size_t) noexcept {}
+
+  void push(const T& val) {
+    total += val;
+  }
+
+  void evict(const T& val) {
+    total -= val;
+  }
+
+  const T& value() const noexcept {
+    return total;
+  }
+};
+
+// Running total divided by the number of samples; the window must not be empty.
+template <typename T, typename Result = double>
+struct window_mean {
+  T total = T();
+  size_t count = 0;
+
+  explicit window_mean(size_t) noexcept {}
+
+  void push(const T& val) {
+    total += val;
+    ++count;
+  }
+
+  void evict(const T& val) {
+    total -= val;
+    --count;
+  }
+
+  Result value() const {
+    assert(count != 0);
+    return static_cast<Result>(total) / static_cast<Result>(count);
+  }
+};
+
+// Monotonic deque: holds the samples that can still become the extreme, in
+// window order, so the front is always the answer. Each sample is pushed and
+// popped at most once, so push is amortized O(1). The window must not be
+// empty for value().
+template <typename T, typename Compare = std::less<T>>
+struct window_extreme {
+  circular_buffer<T> candidates;
+  Compare comp;
+
+  explicit window_extreme(size_t window) : candidates(window) {}
+
+  void push(const T& val) {
+    while (!candidates.empty() && comp(val, candidates.back())) {
+      candidates.pop_back();
+    }
+    candidates.push_back(val);
+  }
+
+  // The front is at least as extreme as every sample in the window,
+  // so the oldest one is the front exactly when it is not more extreme.
+  void evict(const T& val) {
+    if (!comp(candidates.front(), val)) {
+      candidates.pop_front();
+    }
+  }
+
+  const T& value() const noexcept {
+    assert(!candidates.empty());
+    return candidates.front();
+  }
+};
+
+template <typename T>
+using window_min = window_extreme<T, std::less<T>>;
+
+template <typename T>
+using window_max = window_extreme<T, std::greater<T>>;
+
+// The last capacity() samples, with Op kept up to date as push_back evicts
+// the oldest one, so every query is O(1) instead of a walk over the window.
+template <typename T, typename Op>
+class sliding_window {
+  bounded_circular_buffer<T> samples_;
+  Op op_;
+
+public:
+  // O(n), strong
+  explicit sliding_window(size_t window) : samples_(window), op_(window) {
+    assert(window != 0);
+  }
+
+  // O(1) amortized, strong when Op's push and evict do not throw
+  // The sample is stored before Op sees it, so a throwing copy of T leaves
+  // the window and the aggregate as they were.
+  void push_back(const T& val) {
+    if (!full()) {
+      samples_.push_back(val);
+      op_.push(samples_.back());
+      return;
+    }
+    // The push overwrites the oldest sample, so Op is told about a copy.
+    T evicted = samples_.front();
+    samples_.push_back(val);
+    op_.evict(evicted);
+    op_.push(samples_.back());
+  }
+
+  // O(1)
+  decltype(auto) value() const {
+    return op_.value();
+  }
+
+  // O(1), nothrow
+  const Op& aggregate() const noexcept {
+    return op_;
+  }
+
+  // O(1), nothrow
+  const bounded_circular_buffer<T>& samples() const noexcept {
+    return samples_;
+  }
+
+  // O(1), nothrow
+  size_t size() const noexcept {
+    return samples_.size();
+  }
+
+  // O(1), nothrow
+  size_t capacity() const noexcept {
+    return samples_.capacity();
+  }
+
+  // O(1), nothrow
+  bool empty() const noexcept {
+    return samples_.empty();
+  }
+
+  // O(1), nothrow
+  bool full() const noexcept {
+    return samples_.size() == samples_.capacity();
+  }
+
+  // O(n), basic
+  void clear() {
+    samples_.clear();
+    op_ = Op(capacity());
+  }
+};
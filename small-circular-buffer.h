@@ -0,0 +1,229 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+// In-object storage for N elements of a small_circular_buffer.
+template <typename T, size_t N>
+struct small_buffer_arena {
+  alignas(T) unsigned char bytes[sizeof(T) * N];
+  bool used = false;
+
+  T* slots() noexcept {
+    return reinterpret_cast<T*>(bytes);
+  }
+
+  const T* slots() const noexcept {
+    return reinterpret_cast<const T*>(bytes);
+  }
+};
+
+// Hands out the arena for requests of up to N elements while it is free,
+// and goes to the heap otherwise. An allocator without an arena, as made
+// for copies of the container, always uses the heap.
+template <typename T, size_t N>
+class small_buffer_allocator {
+  small_buffer_arena<T, N>* arena_;
+
+  template <typename, size_t>
+  friend class small_buffer_allocator;
+
+public:
+  using value_type = T;
+
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::false_type;
+  using propagate_on_container_swap = std::false_type;
+  using is_always_equal = std::false_type;
+
+  struct allocation_result {
+    T* ptr;
+    size_t count;
+  };
+
+  explicit small_buffer_allocator(small_buffer_arena<T, N>* arena = nullptr) noexcept : arena_(arena) {}
+
+  T* allocate(size_t n) {
+    return allocate_at_least(n).ptr;
+  }
+
+  // The arena always comes with all of its N slots, so contents shrunk back
+  // into it can grow to N again before going to the heap.
+  allocation_result allocate_at_least(size_t n) {
+    if (arena_ != nullptr && n <= N && !arena_->used) {
+      arena_->used = true;
+      return {arena_->slots(), N};
+    }
+    return {std::allocator<T>().allocate(n), n};
+  }
+
+  void deallocate(T* p, size_t n) noexcept {
+    if (arena_ != nullptr && p == arena_->slots()) {
+      arena_->used = false;
+    } else {
+      std::allocator<T>().deallocate(p, n);
+    }
+  }
+
+  small_buffer_allocator select_on_container_copy_construction() const noexcept {
+    return small_buffer_allocator();
+  }
+
+  friend bool operator==(const small_buffer_allocator& a, const small_buffer_allocator& b) noexcept {
+    return a.arena_ == b.arena_;
+  }
+
+  friend bool operator!=(const small_buffer_allocator& a, const small_buffer_allocator& b) noexcept {
+    return !(a == b);
+  }
+};
+
+// circular_buffer that keeps up to N elements inside the object and only
+// allocates once it grows past N. Storage in the arena cannot change
+// owners, so moves and swaps of small contents move the elements. The
+// circular_buffer base is private, since its own moves and swaps would hand
+// the arena over; its interface is re-exported instead.
+template <typename T, size_t N, typename Index = modulo_index>
+class small_circular_buffer : private small_buffer_arena<T, N>,
+                              private circular_buffer<T, small_buffer_allocator<T, N>, Index> {
+  static_assert(N != 0, "use circular_buffer for rings without inline storage");
+  static_assert(Index::round_capacity(N) == N, "N must be a capacity the index policy allows");
+
+  using arena = small_buffer_arena<T, N>;
+  using base = circular_buffer<T, small_buffer_allocator<T, N>, Index>;
+
+public:
+  using typename base::value_type;
+  using typename base::allocator_type;
+  using typename base::reference;
+  using typename base::const_reference;
+  using typename base::pointer;
+  using typename base::const_pointer;
+  using typename base::iterator;
+  using typename base::const_iterator;
+  using typename base::reverse_iterator;
+  using typename base::const_reverse_iterator;
+  using typename base::array_range;
+  using typename base::const_array_range;
+
+  using base::get_allocator;
+  using base::stats;
+  using base::data;
+  using base::size;
+  using base::empty;
+  using base::capacity;
+  using base::begin;
+  using base::end;
+  using base::rbegin;
+  using base::rend;
+  using base::operator[];
+  using base::back;
+  using base::front;
+  using base::push_back;
+  using base::push_front;
+  using base::emplace_back;
+  using base::emplace_front;
+  using base::pop_back;
+  using base::pop_front;
+  using base::array_one;
+  using base::array_two;
+  using base::free_array_one;
+  using base::free_array_two;
+  using base::commit_back;
+  using base::append;
+  using base::append_n;
+  using base::consume_front;
+  using base::consume_back;
+  using base::copy_out;
+  using base::consume_up_to;
+  using base::consume_all;
+  using base::produce;
+  using base::reserve;
+  using base::is_linearized;
+  using base::rotate;
+  using base::insert;
+  using base::erase;
+  using base::clear;
+
+  // O(1), nothrow
+  small_circular_buffer() noexcept : base(N, small_buffer_allocator<T, N>(static_cast<arena*>(this))) {}
+
+  // O(n), strong
+  small_circular_buffer(const small_circular_buffer& other) : small_circular_buffer() {
+    append(other.begin(), other.end());
+  }
+
+  // O(n), nothrow for contents on the heap
+  small_circular_buffer(small_circular_buffer&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+      : small_circular_buffer() {
+    *this = std::move(other);
+  }
+
+  // O(n), basic
+  small_circular_buffer& operator=(const small_circular_buffer& other) {
+    if (this != &other) {
+      clear();
+      append(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  // O(n), O(1) for contents on the heap, basic
+  // Heap storage is taken over; inline contents are moved element by element.
+  small_circular_buffer& operator=(small_circular_buffer&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other) {
+      clear();
+      if (other.on_heap()) {
+        // Empty, so this releases the storage and the swap hands none over.
+        base::shrink_to_fit();
+        swap(static_cast<base&>(*this), static_cast<base&>(other));
+        other.reserve(N);
+      } else {
+        append(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+        other.clear();
+      }
+    }
+    return *this;
+  }
+
+  // O(n), basic
+  friend void swap(small_circular_buffer& a, small_circular_buffer& b) {
+    small_circular_buffer tmp(std::move(a));
+    a = std::move(b);
+    b = std::move(tmp);
+  }
+
+  // O(n), strong
+  // Contents on the heap that fit in N move back into the object, which then
+  // has its full capacity of N again. Inline contents stay where they are.
+  void shrink_to_fit() {
+    if (on_heap()) {
+      base::shrink_to_fit();
+      reserve(N);
+    }
+  }
+
+  // O(n), basic
+  // Inline contents whose moves may throw are rebuilt through a second arena
+  // on the stack rather than new storage, so they stay in the object.
+  pointer linearize() {
+    if constexpr (!std::is_nothrow_move_constructible_v<T> || !std::is_nothrow_move_assignable_v<T>) {
+      if (!on_heap() && !is_linearized()) {
+        small_circular_buffer tmp;
+        if constexpr (std::is_copy_constructible_v<T>) {
+          tmp.append(begin(), end());
+        } else {
+          tmp.append(std::make_move_iterator(begin()), std::make_move_iterator(end()));
+        }
+        clear();
+        append(std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()));
+        return data();
+      }
+    }
+    return base::linearize();
+  }
+
+  // O(1), nothrow
+  bool on_heap() const noexcept {
+    return data() != nullptr && data() != static_cast<const arena&>(*this).slots();
+  }
+};
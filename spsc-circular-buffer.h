@@ -0,0 +1,166 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <atomic>
+#include <new>
+
+// Lock-free ring for exactly one producer thread and one consumer thread.
+// Storage is a power-of-two array of raw slots like circular_buffer; head_
+// and tail_ count pushes and pops without wrapping and are masked on access.
+template <typename T>
+class spsc_circular_buffer {
+  T* data_;
+  size_t capacity_;
+
+  // Written by the consumer only.
+  alignas(cache_line_size) std::atomic<size_t> head_;
+  size_t cached_tail_;
+
+  // Written by the producer only.
+  alignas(cache_line_size) std::atomic<size_t> tail_;
+  size_t cached_head_;
+
+public:
+  using value_type = T;
+
+  // O(1), strong
+  // Capacity is rounded up to a power of two.
+  explicit spsc_circular_buffer(size_t capacity)
+      : data_(nullptr),
+        capacity_(pow2_index::round_capacity(capacity)),
+        head_(0),
+        cached_tail_(0),
+        tail_(0),
+        cached_head_(0) {
+    if (capacity_ != 0) {
+      data_ = static_cast<T*>(operator new(sizeof(T) * capacity_, std::align_val_t(alignof(T))));
+    }
+  }
+
+  spsc_circular_buffer(const spsc_circular_buffer&) = delete;
+  spsc_circular_buffer& operator=(const spsc_circular_buffer&) = delete;
+
+  // O(n), nothrow
+  ~spsc_circular_buffer() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    for (; head != tail; ++head) {
+      slot(head)->~T();
+    }
+    operator delete(data_, std::align_val_t(alignof(T)));
+  }
+
+  // O(1), nothrow
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  // O(1), nothrow
+  // Exact only when neither side is running concurrently.
+  size_t size() const noexcept {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  // O(1), nothrow
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  // Producer side.
+
+  // O(1), strong
+  bool try_push(const T& val) {
+    return try_emplace(val);
+  }
+
+  // O(1), strong
+  bool try_push(T&& val) {
+    return try_emplace(std::move(val));
+  }
+
+  // O(1), strong
+  // Returns false without constructing anything when the ring is full.
+  template <typename... Args>
+  bool try_emplace(Args&&... args) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == capacity_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == capacity_) {
+        return false;
+      }
+    }
+    new (slot(tail)) T(std::forward<Args>(args)...);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // O(n), strong
+  // Pushes as many of the count elements as fit and returns that number.
+  size_t try_push_n(const T* src, size_t count) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (capacity_ - (tail - cached_head_) < count) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    count = std::min(count, capacity_ - (tail - cached_head_));
+    if (count == 0) {
+      return 0;
+    }
+    T* first = slot(tail);
+    size_t head_part = std::min(count, capacity_ - (first - data_));
+    std::uninitialized_copy_n(src, head_part, first);
+    try {
+      std::uninitialized_copy_n(src + head_part, count - head_part, data_);
+    } catch (...) {
+      std::destroy_n(first, head_part);
+      throw;
+    }
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer side.
+
+  // O(1), strong
+  // Returns false and leaves out untouched when the ring is empty.
+  bool try_pop(T& out) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    T* first = slot(head);
+    out = std::move(*first);
+    first->~T();
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // O(n), basic
+  // Pops up to count elements into dst and returns how many were popped.
+  size_t try_pop_n(T* dst, size_t count) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ - head < count) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    count = std::min(count, cached_tail_ - head);
+    if (count == 0) {
+      return 0;
+    }
+    T* first = slot(head);
+    size_t head_part = std::min(count, capacity_ - (first - data_));
+    std::move(first, first + head_part, dst);
+    std::move(data_, data_ + (count - head_part), dst + head_part);
+    std::destroy_n(first, head_part);
+    std::destroy_n(data_, count - head_part);
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+private:
+  T* slot(size_t index) const noexcept {
+    return data_ + pow2_index::wrap(index, capacity_);
+  }
+};
@@ -0,0 +1,482 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <new>
+
+// Slots and bookkeeping of a static_circular_buffer. Trivial T lives in a
+// plain array, so the whole buffer is a literal type usable in constant
+// expressions; other T gets raw aligned bytes and explicit lifetimes.
+template <typename T, size_t N, bool = std::is_trivial_v<T>>
+struct static_buffer_storage {
+  T slots_[N] = {};
+  size_t head_ = 0;
+  size_t size_ = 0;
+
+  constexpr T* slots() noexcept {
+    return slots_;
+  }
+
+  constexpr const T* slots() const noexcept {
+    return slots_;
+  }
+
+  template <typename... Args>
+  constexpr void construct(size_t slot, Args&&... args) {
+    slots_[slot] = T(std::forward<Args>(args)...);
+  }
+
+  constexpr void destroy(size_t) noexcept {}
+};
+
+template <typename T, size_t N>
+struct static_buffer_storage<T, N, false> {
+  alignas(T) unsigned char bytes_[sizeof(T) * N];
+  size_t head_ = 0;
+  size_t size_ = 0;
+
+  static_buffer_storage() noexcept = default;
+
+  // O(n), strong
+  static_buffer_storage(const static_buffer_storage& other) {
+    copy_from(other);
+  }
+
+  // O(n), nothrow
+  static_buffer_storage(static_buffer_storage&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    move_from(other);
+  }
+
+  // O(n), basic
+  static_buffer_storage& operator=(const static_buffer_storage& other) {
+    if (this != &other) {
+      destroy_all();
+      copy_from(other);
+    }
+    return *this;
+  }
+
+  // O(n), basic
+  static_buffer_storage& operator=(static_buffer_storage&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other) {
+      destroy_all();
+      move_from(other);
+    }
+    return *this;
+  }
+
+  // O(n), nothrow
+  ~static_buffer_storage() {
+    destroy_all();
+  }
+
+  T* slots() noexcept {
+    return std::launder(reinterpret_cast<T*>(bytes_));
+  }
+
+  const T* slots() const noexcept {
+    return std::launder(reinterpret_cast<const T*>(bytes_));
+  }
+
+  template <typename... Args>
+  void construct(size_t slot, Args&&... args) {
+    new (slots() + slot) T(std::forward<Args>(args)...);
+  }
+
+  void destroy(size_t slot) noexcept {
+    slots()[slot].~T();
+  }
+
+private:
+  static size_t wrap(size_t index) noexcept {
+    return pow2_index::wrap(index, N);
+  }
+
+  // Keeps other's slot layout, so head_ carries over unchanged. When an
+  // element throws, the ones already built are destroyed, since a
+  // constructor that throws never runs the destructor.
+  void copy_from(const static_buffer_storage& other) {
+    head_ = other.head_;
+    size_ = 0;
+    try {
+      for (; size_ < other.size_; ++size_) {
+        new (slots() + wrap(head_ + size_)) T(other.slots()[wrap(head_ + size_)]);
+      }
+    } catch (...) {
+      destroy_all();
+      throw;
+    }
+  }
+
+  void move_from(static_buffer_storage& other) {
+    head_ = other.head_;
+    size_ = 0;
+    try {
+      for (; size_ < other.size_; ++size_) {
+        new (slots() + wrap(head_ + size_)) T(std::move(other.slots()[wrap(head_ + size_)]));
+      }
+    } catch (...) {
+      destroy_all();
+      throw;
+    }
+  }
+
+  void destroy_all() noexcept {
+    for (; size_ != 0; --size_) {
+      destroy(wrap(head_ + size_ - 1));
+    }
+  }
+};
+
+// Ring of exactly N elements stored inside the object: nothing is ever
+// allocated and, with N a power of two known at compile time, every index
+// wraps with a constant mask. A full buffer overwrites its oldest element
+// like bounded_circular_buffer. For trivial T all operations are constexpr.
+template <typename T, size_t N>
+class static_circular_buffer : private static_buffer_storage<T, N> {
+  static_assert(N != 0 && pow2_index::round_capacity(N) == N, "N must be a power of two");
+
+  using storage = static_buffer_storage<T, N>;
+  using storage::head_;
+  using storage::size_;
+
+  template <class I>
+  struct buffer_iterator {
+    using value_type = T;
+    using reference = I&;
+    using pointer = I*;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::random_access_iterator_tag;
+
+  private:
+    I* first_;
+    size_t slot_;
+    ptrdiff_t offset_;
+
+    template <class J>
+    friend struct buffer_iterator;
+
+  public:
+    constexpr buffer_iterator() noexcept : first_(nullptr), slot_(0), offset_(0) {}
+
+    constexpr buffer_iterator(I* first, size_t slot, ptrdiff_t offset) noexcept
+        : first_(first), slot_(slot), offset_(offset) {}
+
+    template <class J>
+    constexpr buffer_iterator(const buffer_iterator<J>& other) noexcept
+        : first_(other.first_), slot_(other.slot_), offset_(other.offset_) {}
+
+    constexpr buffer_iterator& operator++() noexcept {
+      ++offset_;
+      slot_ = wrap(slot_ + 1);
+      return *this;
+    }
+
+    constexpr buffer_iterator operator++(int) noexcept {
+      buffer_iterator temp = *this;
+      ++*this;
+      return temp;
+    }
+
+    constexpr buffer_iterator& operator--() noexcept {
+      --offset_;
+      slot_ = wrap(slot_ - 1);
+      return *this;
+    }
+
+    constexpr buffer_iterator operator--(int) noexcept {
+      buffer_iterator temp = *this;
+      --*this;
+      return temp;
+    }
+
+    constexpr buffer_iterator operator+(ptrdiff_t offset) const noexcept {
+      return buffer_iterator(first_, wrap(slot_ + offset), offset_ + offset);
+    }
+
+    friend constexpr buffer_iterator operator+(ptrdiff_t offset, buffer_iterator a) noexcept {
+      return a + offset;
+    }
+
+    constexpr buffer_iterator operator-(ptrdiff_t offset) const noexcept {
+      return *this + (-offset);
+    }
+
+    constexpr buffer_iterator& operator+=(ptrdiff_t offset) noexcept {
+      return *this = *this + offset;
+    }
+
+    constexpr buffer_iterator& operator-=(ptrdiff_t offset) noexcept {
+      return *this = *this - offset;
+    }
+
+    template <class J>
+    constexpr ptrdiff_t operator-(const buffer_iterator<J>& other) const noexcept {
+      return offset_ - other.offset_;
+    }
+
+    constexpr reference operator[](ptrdiff_t offset) const noexcept {
+      return *(*this + offset);
+    }
+
+    constexpr reference operator*() const noexcept {
+      return first_[slot_];
+    }
+
+    constexpr pointer operator->() const noexcept {
+      return first_ + slot_;
+    }
+
+    template <class J>
+    constexpr bool operator==(const buffer_iterator<J>& other) const noexcept {
+      return first_ == other.first_ && offset_ == other.offset_;
+    }
+
+    template <class J>
+    constexpr bool operator!=(const buffer_iterator<J>& other) const noexcept {
+      return !(*this == other);
+    }
+
+    template <class J>
+    constexpr bool operator<(const buffer_iterator<J>& other) const noexcept {
+      return offset_ < other.offset_;
+    }
+
+    template <class J>
+    constexpr bool operator>(const buffer_iterator<J>& other) const noexcept {
+      return other < *this;
+    }
+
+    template <class J>
+    constexpr bool operator<=(const buffer_iterator<J>& other) const noexcept {
+      return !(other < *this);
+    }
+
+    template <class J>
+    constexpr bool operator>=(const buffer_iterator<J>& other) const noexcept {
+      return !(*this < other);
+    }
+  };
+
+public:
+  using value_type = T;
+
+  using reference = T&;
+  using const_reference = const T&;
+
+  using pointer = T*;
+  using const_pointer = const T*;
+
+  using iterator = buffer_iterator<T>;
+  using const_iterator = buffer_iterator<const T>;
+
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  using array_range = std::pair<pointer, size_t>;
+  using const_array_range = std::pair<const_pointer, size_t>;
+
+public:
+  constexpr static_circular_buffer() noexcept = default;
+
+  constexpr pointer data() noexcept {
+    return this->slots();
+  }
+
+  constexpr const_pointer data() const noexcept {
+    return this->slots();
+  }
+
+  // O(1), nothrow
+  constexpr size_t size() const noexcept {
+    return size_;
+  }
+
+  // O(1), nothrow
+  constexpr bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  // O(1), nothrow
+  constexpr bool full() const noexcept {
+    return size() == N;
+  }
+
+  // O(1), nothrow
+  static constexpr size_t capacity() noexcept {
+    return N;
+  }
+
+  // O(1), nothrow
+  constexpr iterator begin() noexcept {
+    return {data(), head_, 0};
+  }
+
+  // O(1), nothrow
+  constexpr const_iterator begin() const noexcept {
+    return {data(), head_, 0};
+  }
+
+  // O(1), nothrow
+  constexpr iterator end() noexcept {
+    return {data(), wrap(head_ + size_), static_cast<ptrdiff_t>(size_)};
+  }
+
+  // O(1), nothrow
+  constexpr const_iterator end() const noexcept {
+    return {data(), wrap(head_ + size_), static_cast<ptrdiff_t>(size_)};
+  }
+
+  // O(1), nothrow
+  constexpr reverse_iterator rbegin() noexcept {
+    return reverse_iterator(end());
+  }
+
+  // O(1), nothrow
+  constexpr const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+
+  // O(1), nothrow
+  constexpr reverse_iterator rend() noexcept {
+    return reverse_iterator(begin());
+  }
+
+  // O(1), nothrow
+  constexpr const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  // O(1), nothrow
+  constexpr T& operator[](size_t index) {
+    return data()[wrap(head_ + index)];
+  }
+
+  // O(1), nothrow
+  constexpr const T& operator[](size_t index) const {
+    return data()[wrap(head_ + index)];
+  }
+
+  // O(1), nothrow
+  constexpr T& back() {
+    return (*this)[size_ - 1];
+  }
+
+  // O(1), nothrow
+  constexpr const T& back() const {
+    return (*this)[size_ - 1];
+  }
+
+  // O(1), nothrow
+  constexpr T& front() {
+    return data()[head_];
+  }
+
+  // O(1), nothrow
+  constexpr const T& front() const {
+    return data()[head_];
+  }
+
+  // O(1), strong
+  constexpr void push_back(const T& val) {
+    emplace_back(val);
+  }
+
+  // O(1), strong
+  constexpr void push_back(T&& val) {
+    emplace_back(std::move(val));
+  }
+
+  // O(1), strong
+  constexpr void push_front(const T& val) {
+    emplace_front(val);
+  }
+
+  // O(1), strong
+  constexpr void push_front(T&& val) {
+    emplace_front(std::move(val));
+  }
+
+  // O(1), strong
+  // When full, replaces front() by assignment.
+  template <typename... Args>
+  constexpr T& emplace_back(Args&&... args) {
+    if (full()) {
+      T& slot = data()[head_] = T(std::forward<Args>(args)...);
+      head_ = wrap(head_ + 1);
+      return slot;
+    }
+    size_t slot = wrap(head_ + size_);
+    this->construct(slot, std::forward<Args>(args)...);
+    ++size_;
+    return data()[slot];
+  }
+
+  // O(1), strong
+  // When full, replaces back() by assignment.
+  template <typename... Args>
+  constexpr T& emplace_front(Args&&... args) {
+    size_t slot = wrap(head_ - 1);
+    if (full()) {
+      data()[slot] = T(std::forward<Args>(args)...);
+    } else {
+      this->construct(slot, std::forward<Args>(args)...);
+      ++size_;
+    }
+    head_ = slot;
+    return data()[slot];
+  }
+
+  // O(1), nothrow
+  constexpr void pop_back() {
+    --size_;
+    this->destroy(wrap(head_ + size_));
+  }
+
+  // O(1), nothrow
+  constexpr void pop_front() {
+    --size_;
+    this->destroy(head_);
+    head_ = wrap(head_ + 1);
+  }
+
+  // O(n), O(1) for trivially destructible T, nothrow
+  constexpr void clear() noexcept {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      while (!empty()) {
+        pop_back();
+      }
+    }
+    head_ = 0;
+    size_ = 0;
+  }
+
+  // O(1), nothrow
+  constexpr array_range array_one() noexcept {
+    return {data() + head_, first_run()};
+  }
+
+  // O(1), nothrow
+  constexpr const_array_range array_one() const noexcept {
+    return {data() + head_, first_run()};
+  }
+
+  // O(1), nothrow
+  constexpr array_range array_two() noexcept {
+    return {data(), size_ - first_run()};
+  }
+
+  // O(1), nothrow
+  constexpr const_array_range array_two() const noexcept {
+    return {data(), size_ - first_run()};
+  }
+
+private:
+  static constexpr size_t wrap(size_t index) noexcept {
+    return pow2_index::wrap(index, N);
+  }
+
+  constexpr size_t first_run() const noexcept {
+    return std::min(size_, N - head_);
+  }
+};
@@ -0,0 +1,85 @@
+#include "circular-buffer-algorithm.h"
+
+#include "static-circular-buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+// count elements, wrapped so that array_two() is not empty.
+template <typename T>
+circular_buffer<T> make_wrapped(size_t count) {
+  circular_buffer<T> b(count);
+  for (size_t i = 0; i < count / 2; ++i) {
+    b.push_back(T());
+  }
+  b.consume_front(count / 2);
+  for (size_t i = 0; i < count; ++i) {
+    b.push_back(static_cast<T>(i % 100));
+  }
+  return b;
+}
+
+} // namespace
+
+TEST(algorithm, find_and_count_span_the_wrap) {
+  circular_buffer<int32_t> b = make_wrapped<int32_t>(1000);
+  ASSERT_NE(b.array_two().second, 0u);
+  EXPECT_EQ(cb::find(b, 42) - b.begin(), 42);
+  EXPECT_EQ(cb::find(b, 999), b.end());
+  b.back() = 999;
+  EXPECT_EQ(cb::find(b, 999) - b.begin(), 999);
+  EXPECT_EQ(cb::count(b, 7), 10u);
+
+  circular_buffer<uint8_t> bytes = make_wrapped<uint8_t>(777);
+  EXPECT_EQ(cb::count(bytes, uint8_t(5)), 8u);
+  EXPECT_EQ(cb::find(bytes, uint8_t(99)) - bytes.begin(), 99);
+  EXPECT_EQ(cb::memchr(bytes, 98) - bytes.begin(), 98);
+  EXPECT_EQ(cb::memchr(bytes, 200), bytes.end());
+}
+
+TEST(algorithm, sum_and_minmax) {
+  circular_buffer<double> b = make_wrapped<double>(500);
+  EXPECT_DOUBLE_EQ(cb::sum(b), 5 * 4950.0);
+  circular_buffer<int64_t> c = make_wrapped<int64_t>(300);
+  c[150] = -5;
+  c[299] = 1000;
+  auto [lo, hi] = cb::minmax(c);
+  EXPECT_EQ(lo, -5);
+  EXPECT_EQ(hi, 1000);
+  EXPECT_EQ(cb::sum(c, int64_t(1)), std::accumulate(c.begin(), c.end(), int64_t(1)));
+
+  circular_buffer<float> f = make_wrapped<float>(300);
+  f[10] = -2.5f;
+  f[250] = 1e6f;
+  auto [flo, fhi] = cb::minmax(f);
+  EXPECT_EQ(flo, -2.5f);
+  EXPECT_EQ(fhi, 1e6f);
+}
+
+TEST(algorithm, sum_widens_small_types) {
+  circular_buffer<uint8_t> bytes = make_wrapped<uint8_t>(100);
+  static_assert(std::is_same_v<decltype(cb::sum(bytes)), long long>);
+  EXPECT_EQ(cb::sum(bytes), 4950);
+  EXPECT_EQ(cb::sum(bytes, uint8_t(0)), uint8_t(4950 % 256));
+
+  circular_buffer<float> f = make_wrapped<float>(100);
+  static_assert(std::is_same_v<decltype(cb::sum(f)), double>);
+  EXPECT_DOUBLE_EQ(cb::sum(f), 4950.0);
+}
+
+TEST(algorithm, works_on_other_buffers) {
+  static_circular_buffer<int32_t, 8> s;
+  for (int i = 0; i < 11; ++i) {
+    s.push_back(i);
+  }
+  EXPECT_EQ(cb::count(s, 9), 1u);
+  EXPECT_EQ(*cb::find(s, 9), 9);
+  EXPECT_EQ(cb::sum(s), 3 + 4 + 5 + 6 + 7 + 8 + 9 + 10);
+}
@@ -0,0 +1,58 @@
+#include "aligned-allocator.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+namespace {
+
+struct record {
+  char bytes[48];
+};
+
+bool aligned_to(const void* p, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+} // namespace
+
+static_assert(sizeof(cache_line_padded<record>) == cache_line_size);
+static_assert(alignof(cache_line_padded<char>) == cache_line_size);
+
+TEST(aligned_allocator, storage_starts_on_a_cache_line) {
+  aligned_circular_buffer<record> b;
+  for (int i = 0; i < 100; ++i) {
+    b.push_back(record{{static_cast<char>(i)}});
+    ASSERT_TRUE(aligned_to(b.data(), cache_line_size));
+  }
+  // Storage is whole cache lines: 48 * capacity is a multiple of 64.
+  EXPECT_EQ(b.capacity() % 4, 0u);
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(b.front().bytes[0], static_cast<char>(i));
+    b.pop_front();
+  }
+}
+
+TEST(aligned_allocator, wider_alignments_and_slack) {
+  aligned_circular_buffer<cache_line_padded<std::string>, 128> s;
+  for (int i = 0; i < 50; ++i) {
+    s.push_back({std::to_string(i)});
+  }
+  EXPECT_TRUE(aligned_to(s.data(), 128));
+  EXPECT_EQ(s[49].value, "49");
+
+  circular_buffer<int, aligned_allocator<int>, pow2_index> p;
+  for (int i = 0; i < 33; ++i) {
+    p.push_back(i);
+  }
+  EXPECT_EQ(p.capacity(), 64u);
+
+  circular_buffer<char, aligned_allocator<char>> c(1);
+  EXPECT_EQ(c.capacity(), 64u);
+  c.push_back('x');
+  circular_buffer<char, aligned_allocator<char>> copy = c;
+  circular_buffer<char, aligned_allocator<char>> moved = std::move(copy);
+  c = moved;
+  EXPECT_EQ(c.front(), 'x');
+}
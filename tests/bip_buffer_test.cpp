@@ -0,0 +1,104 @@
+#include "bip-buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+
+TEST(bip_buffer, records_come_back_whole_and_in_order) {
+  std::mt19937 random(5);
+  for (size_t capacity : {0, 7, 64, 1000}) {
+    bip_buffer b(capacity);
+    std::deque<std::string> model;
+    size_t used = 0;
+    for (int i = 0; i < 20000; ++i) {
+      if (random() % 2 != 0) {
+        std::string record(random() % 40, static_cast<char>('a' + i % 26));
+        if (b.push_record(record.data(), record.size())) {
+          model.push_back(record);
+          used += bip_buffer::record_prefix + record.size();
+        }
+      } else if (!model.empty()) {
+        bip_buffer::const_array_range front = b.front_record();
+        ASSERT_EQ(std::string(reinterpret_cast<const char*>(front.first), front.second), model.front());
+        b.pop_record();
+        used -= bip_buffer::record_prefix + model.front().size();
+        model.pop_front();
+      }
+      ASSERT_EQ(b.size(), used);
+      ASSERT_EQ(b.empty(), model.empty());
+    }
+  }
+}
+
+TEST(bip_buffer, reservations_never_split) {
+  bip_buffer raw(10);
+  unsigned char* p = raw.reserve(8);
+  ASSERT_NE(p, nullptr);
+  std::memcpy(p, "abcdefgh", 8);
+  raw.commit(6);
+  raw.consume(4);
+  EXPECT_EQ(raw.readable().second, 2u);
+  EXPECT_EQ(raw.reserve(5), nullptr);
+
+  p = raw.reserve(4);
+  EXPECT_EQ(p, raw.readable().first + 2);
+  std::memcpy(p, "wxyz", 4);
+  raw.commit(4);
+
+  // No room left at the end, so region B starts at the front of storage.
+  const unsigned char* base = raw.readable().first - 4;
+  p = raw.reserve(3);
+  EXPECT_EQ(p, base);
+  std::memcpy(p, "123", 3);
+  raw.commit(3);
+  EXPECT_EQ(raw.size(), 9u);
+  EXPECT_EQ(raw.readable().second, 6u);
+  EXPECT_EQ(raw.reserve(2), nullptr);
+
+  raw.consume(6);
+  EXPECT_EQ(raw.readable().first, base);
+  EXPECT_EQ(raw.readable().second, 3u);
+  EXPECT_EQ(std::memcmp(base, "123", 3), 0);
+}
+
+TEST(bip_buffer, commit_after_draining_a_promotes_b) {
+  bip_buffer b(100);
+  std::string forty(40, 'a');
+  ASSERT_TRUE(b.push_record(forty.data(), forty.size()));
+  ASSERT_TRUE(b.push_record(forty.data(), forty.size()));
+  b.pop_record();
+  unsigned char* first = b.reserve_record(30);
+  ASSERT_NE(first, nullptr);
+  std::memset(first, 'b', 30);
+  b.pop_record();
+  EXPECT_TRUE(b.empty());
+  b.commit_record(30);
+  EXPECT_EQ(b.size(), 34u);
+  EXPECT_EQ(b.readable().second, 34u);
+  auto record = b.front_record();
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(record.first), record.second), std::string(30, 'b'));
+  b.pop_record();
+  EXPECT_TRUE(b.empty());
+}
+
+TEST(bip_buffer, failed_reserve_keeps_the_pending_one) {
+  bip_buffer b(100);
+  std::string forty(40, 'a');
+  ASSERT_TRUE(b.push_record(forty.data(), forty.size()));
+  unsigned char* first = b.reserve_record(10);
+  ASSERT_NE(first, nullptr);
+  std::memset(first, 'b', 10);
+  b.pop_record();
+  EXPECT_TRUE(b.empty());
+  EXPECT_EQ(b.reserve(200), nullptr);
+  b.commit_record(10);
+  EXPECT_EQ(b.size(), 14u);
+  auto record = b.front_record();
+  EXPECT_EQ(record.first, first);
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(record.first), record.second), std::string(10, 'b'));
+  b.pop_record();
+  EXPECT_TRUE(b.empty());
+}
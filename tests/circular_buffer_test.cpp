@@ -0,0 +1,407 @@
+#include "circular-buffer.h"
+
+#include "test-types.h"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <limits>
+#include <list>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+template <typename Buffer>
+std::vector<typename Buffer::value_type> contents(const Buffer& buffer) {
+  return std::vector<typename Buffer::value_type>(buffer.begin(), buffer.end());
+}
+
+// Replays the same mix of operations on a buffer and a deque.
+template <typename Buffer>
+void check_against_deque() {
+  Buffer b;
+  std::deque<int> d;
+  for (int i = 0; i < 100; ++i) {
+    if (i % 3 != 0) {
+      b.push_back(i);
+      d.push_back(i);
+    } else {
+      b.push_front(i);
+      d.push_front(i);
+    }
+  }
+  for (int i = 0; i < 30; ++i) {
+    b.pop_front();
+    d.pop_front();
+    b.pop_back();
+    d.pop_back();
+  }
+  b.insert(b.begin() + 5, 777);
+  d.insert(d.begin() + 5, 777);
+  b.insert(b.begin() + 30, 3, 778);
+  d.insert(d.begin() + 30, 3, 778);
+  b.erase(b.begin() + 3, b.begin() + 7);
+  d.erase(d.begin() + 3, d.begin() + 7);
+  b.erase(b.begin() + 25, b.begin() + 29);
+  d.erase(d.begin() + 25, d.begin() + 29);
+  ASSERT_EQ(b.size(), d.size());
+  for (size_t i = 0; i < d.size(); ++i) {
+    EXPECT_EQ(b[i], d[i]);
+  }
+  EXPECT_TRUE(std::equal(b.begin(), b.end(), d.begin(), d.end()));
+  EXPECT_TRUE(std::equal(b.rbegin(), b.rend(), d.rbegin(), d.rend()));
+  Buffer copy = b;
+  EXPECT_TRUE(std::equal(copy.begin(), copy.end(), d.begin(), d.end()));
+}
+
+} // namespace
+
+TEST(circular_buffer, matches_deque) {
+  check_against_deque<circular_buffer<int>>();
+  check_against_deque<circular_buffer_pow2<int>>();
+}
+
+static_assert(std::is_convertible_v<circular_buffer<int>::iterator, circular_buffer<int>::const_iterator>);
+static_assert(!std::is_convertible_v<circular_buffer<int>::const_iterator, circular_buffer<int>::iterator>);
+static_assert(!std::is_constructible_v<circular_buffer<int>::iterator, circular_buffer<int>::const_iterator>);
+
+TEST(circular_buffer, iterators_are_random_access) {
+  circular_buffer<int> b(8);
+  for (int i = 0; i < 8; ++i) {
+    b.push_back(i);
+  }
+  b.pop_front();
+  b.pop_front();
+  b.push_back(8);
+  b.push_back(9);
+  auto first = b.begin();
+  auto last = b.end();
+  EXPECT_EQ(last - first, 8);
+  EXPECT_TRUE(first < last);
+  EXPECT_TRUE(first + 8 == last);
+  EXPECT_EQ(first[7], 9);
+  EXPECT_EQ(*(last - 1), 9);
+  circular_buffer<int>::const_iterator c = first + 3;
+  EXPECT_EQ(*c, 5);
+  EXPECT_TRUE(c > first && c <= last && first <= c && last >= c);
+  std::vector<int> sorted(b.rbegin(), b.rend());
+  std::sort(b.begin(), b.end(), std::greater<>());
+  EXPECT_EQ(contents(b), sorted);
+}
+
+TEST(circular_buffer, pow2_rounds_capacity) {
+  circular_buffer_pow2<std::string> b;
+  b.reserve(5);
+  EXPECT_EQ(b.capacity(), 8u);
+  for (int i = 0; i < 20; ++i) {
+    b.push_back(std::to_string(i));
+  }
+  EXPECT_EQ(b.capacity(), 32u);
+  EXPECT_EQ(b[19], "19");
+  EXPECT_EQ(pow2_index::round_capacity(0), 0u);
+  EXPECT_EQ(pow2_index::round_capacity(1), 1u);
+  EXPECT_EQ(pow2_index::round_capacity(1025), 2048u);
+
+  constexpr size_t top = (std::numeric_limits<size_t>::max() >> 1) + 1;
+  EXPECT_EQ(pow2_index::round_capacity(top), top);
+  EXPECT_THROW(pow2_index::round_capacity(top + 1), std::length_error);
+  EXPECT_THROW(pow2_index::round_capacity(std::numeric_limits<size_t>::max()), std::length_error);
+}
+
+TEST(circular_buffer, moves_instead_of_copying) {
+  circular_buffer<std::vector<int>> b;
+  std::vector<int> v(100, 1);
+  const int* storage = v.data();
+  b.push_back(std::move(v));
+  for (int i = 0; i < 50; ++i) {
+    b.emplace_back(3, i);
+  }
+  EXPECT_EQ(b.front().data(), storage);
+  EXPECT_EQ(b.emplace_front(2, 7).size(), 2u);
+  EXPECT_EQ(b.front(), std::vector<int>(2, 7));
+}
+
+TEST(circular_buffer, emplace_may_refer_into_the_buffer) {
+  circular_buffer<std::string> b;
+  b.reserve(2);
+  b.push_back("first");
+  b.push_back("second");
+  b.push_back(b.front());
+  b.push_front(b.back());
+  EXPECT_EQ(contents(b), (std::vector<std::string>{"first", "first", "second", "first"}));
+}
+
+TEST(circular_buffer, growth_keeps_strong_guarantee) {
+  {
+    circular_buffer<throwing_copy> b;
+    b.reserve(4);
+    for (int i = 0; i < 4; ++i) {
+      b.push_back(throwing_copy(i));
+    }
+    throwing_copy::arm(2);
+    EXPECT_THROW(b.push_back(throwing_copy(9)), std::runtime_error);
+    throwing_copy::arm(-1);
+    EXPECT_EQ(b.size(), 4u);
+    EXPECT_EQ(b.capacity(), 4u);
+    EXPECT_EQ(b[3].value, throwing_copy(3).value);
+  }
+  EXPECT_EQ(throwing_copy::live, 0);
+}
+
+TEST(circular_buffer, array_ranges_cover_contents) {
+  circular_buffer<int> b;
+  b.reserve(8);
+  for (int i = 0; i < 8; ++i) {
+    b.push_back(i);
+  }
+  for (int i = 0; i < 5; ++i) {
+    b.pop_front();
+  }
+  b.push_back(8);
+  b.push_back(9);
+  auto one = b.array_one();
+  auto two = b.array_two();
+  EXPECT_EQ(one.second + two.second, b.size());
+  std::vector<int> joined(one.first, one.first + one.second);
+  joined.insert(joined.end(), two.first, two.first + two.second);
+  EXPECT_EQ(joined, contents(b));
+
+  auto free_one = b.free_array_one();
+  auto free_two = b.free_array_two();
+  EXPECT_EQ(free_one.second + free_two.second, b.capacity() - b.size());
+  std::fill_n(free_one.first, free_one.second, 42);
+  b.commit_back(free_one.second);
+  EXPECT_EQ(b.back(), 42);
+}
+
+TEST(circular_buffer, bulk_operations) {
+  circular_buffer<int> b;
+  b.reserve(4);
+  std::vector<int> src(10);
+  std::iota(src.begin(), src.end(), 0);
+  b.append_n(src.data(), 3);
+  b.consume_front(2);
+  b.append_n(src.data() + 3, 7);
+  EXPECT_EQ(contents(b), (std::vector<int>{2, 3, 4, 5, 6, 7, 8, 9}));
+  std::vector<int> out(5);
+  EXPECT_EQ(b.copy_out(out.data(), 5), out.data() + 5);
+  EXPECT_EQ(out, (std::vector<int>{2, 3, 4, 5, 6}));
+
+  circular_buffer<std::string> s;
+  std::list<std::string> words = {"a", "b", "c"};
+  s.append(words.begin(), words.end());
+  std::istringstream in("d e");
+  s.append(std::istream_iterator<std::string>(in), std::istream_iterator<std::string>());
+  EXPECT_EQ(contents(s), (std::vector<std::string>{"a", "b", "c", "d", "e"}));
+  s.consume_back(2);
+  EXPECT_EQ(s.back(), "c");
+}
+
+TEST(circular_buffer, batched_consume_and_produce) {
+  circular_buffer<int> b(8);
+  for (int i = 0; i < 8; ++i) {
+    b.push_back(i);
+  }
+  b.consume_front(6);
+  for (int i = 8; i < 12; ++i) {
+    b.push_back(i);
+  }
+  std::vector<size_t> runs;
+  std::vector<int> seen;
+  EXPECT_EQ(b.consume_all([&](int* first, size_t count) {
+    runs.push_back(count);
+    seen.insert(seen.end(), first, first + count);
+  }),
+            6u);
+  EXPECT_EQ(runs, (std::vector<size_t>{2, 4}));
+  EXPECT_EQ(seen, (std::vector<int>{6, 7, 8, 9, 10, 11}));
+  EXPECT_TRUE(b.empty());
+
+  size_t made = b.produce(5, [](int* first, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      first[i] = static_cast<int>(i);
+    }
+    return count;
+  });
+  EXPECT_EQ(made, 5u);
+  EXPECT_EQ(b.size(), 5u);
+  EXPECT_EQ(b.consume_up_to(2, [](int*, size_t) {}), 2u);
+  EXPECT_EQ(b.front(), 2);
+}
+
+TEST(circular_buffer, bounded_overwrites_oldest) {
+  bounded_circular_buffer<int> b(3);
+  for (int i = 0; i < 5; ++i) {
+    b.push_back(i);
+  }
+  EXPECT_EQ(b.capacity(), 3u);
+  EXPECT_EQ(contents(b), (std::vector<int>{2, 3, 4}));
+  b.push_front(-1);
+  EXPECT_EQ(contents(b), (std::vector<int>{-1, 2, 3}));
+  std::vector<int> src = {10, 11, 12, 13};
+  b.append_n(src.data(), src.size());
+  EXPECT_EQ(contents(b), (std::vector<int>{11, 12, 13}));
+  b.insert(b.begin() + 1, 99);
+  EXPECT_EQ(contents(b), (std::vector<int>{99, 12, 13}));
+  EXPECT_EQ(b.capacity(), 3u);
+
+  // A single-pass range drops the same elements as a forward one.
+  bounded_circular_buffer<int> forward = b;
+  std::vector<int> more = {20, 21};
+  forward.insert(forward.begin() + 2, more.begin(), more.end());
+  std::istringstream in("20 21");
+  b.insert(b.begin() + 2, std::istream_iterator<int>(in), std::istream_iterator<int>());
+  EXPECT_EQ(contents(b), contents(forward));
+  EXPECT_EQ(contents(b), (std::vector<int>{20, 21, 13}));
+  EXPECT_EQ(b.capacity(), 3u);
+}
+
+TEST(circular_buffer, bounded_needs_a_capacity) {
+  static_assert(!std::is_default_constructible_v<bounded_circular_buffer<int>>);
+  static_assert(!std::is_constructible_v<bounded_circular_buffer<int>, const std::allocator<int>&>);
+  static_assert(std::is_default_constructible_v<circular_buffer<int>>);
+  EXPECT_THROW(bounded_circular_buffer<int>(0), std::invalid_argument);
+  EXPECT_EQ(circular_buffer<int>(0).capacity(), 0u);
+
+  bounded_circular_buffer<int> b(2);
+  bounded_circular_buffer<int> c = std::move(b);
+  b = c;
+  b.push_back(1);
+  b.push_back(2);
+  b.push_back(3);
+  EXPECT_EQ(contents(b), (std::vector<int>{2, 3}));
+}
+
+TEST(circular_buffer, copies_and_moves) {
+  circular_buffer<std::string> a;
+  for (int i = 0; i < 10; ++i) {
+    a.push_front(std::to_string(i));
+  }
+  circular_buffer<std::string> b = a;
+  EXPECT_EQ(contents(a), contents(b));
+  circular_buffer<std::string> c;
+  c = b;
+  EXPECT_EQ(contents(c), contents(a));
+  circular_buffer<std::string> d = std::move(b);
+  EXPECT_TRUE(b.empty());
+  EXPECT_EQ(contents(d), contents(a));
+  c = std::move(d);
+  EXPECT_EQ(contents(c), contents(a));
+  swap(a, b);
+  EXPECT_TRUE(a.empty());
+  EXPECT_EQ(b.size(), 10u);
+}
+
+TEST(circular_buffer, elements_are_destroyed) {
+  {
+    circular_buffer<counted> b;
+    for (int i = 0; i < 20; ++i) {
+      b.emplace_back(i);
+    }
+    b.erase(b.begin() + 2, b.begin() + 5);
+    b.insert(b.begin() + 4, 3, counted(1));
+    b.consume_front(3);
+    b.shrink_to_fit();
+    b.rotate(b.begin() + 5);
+    b.linearize();
+    circular_buffer<counted> copy = b;
+    EXPECT_EQ(counted::live, static_cast<long>(2 * b.size()));
+  }
+  EXPECT_EQ(counted::live, 0);
+}
+
+TEST(circular_buffer, shrink_linearize_rotate) {
+  circular_buffer<int> b(16);
+  for (int i = 0; i < 16; ++i) {
+    b.push_back(i);
+  }
+  b.consume_front(10);
+  b.push_back(16);
+  b.push_back(17);
+  EXPECT_FALSE(b.is_linearized());
+  int* first = b.linearize();
+  EXPECT_TRUE(b.is_linearized());
+  EXPECT_EQ(std::vector<int>(first, first + b.size()), (std::vector<int>{10, 11, 12, 13, 14, 15, 16, 17}));
+  b.rotate(b.begin() + 3);
+  EXPECT_EQ(contents(b), (std::vector<int>{13, 14, 15, 16, 17, 10, 11, 12}));
+  b.shrink_to_fit();
+  EXPECT_EQ(b.capacity(), 8u);
+  EXPECT_EQ(contents(b), (std::vector<int>{13, 14, 15, 16, 17, 10, 11, 12}));
+}
+
+TEST(circular_buffer, bounded_shrink_keeps_the_ring) {
+  bounded_circular_buffer<int> b(8);
+  b.shrink_to_fit();
+  EXPECT_EQ(b.capacity(), 8u);
+  b.push_back(1);
+  b.push_back(2);
+  b.shrink_to_fit();
+  EXPECT_EQ(b.capacity(), 8u);
+  for (int i = 3; i <= 10; ++i) {
+    b.push_back(i);
+  }
+  EXPECT_EQ(contents(b), (std::vector<int>{3, 4, 5, 6, 7, 8, 9, 10}));
+}
+
+TEST(circular_buffer, growth_policies) {
+  circular_buffer<int, std::allocator<int>, modulo_index, grow_by_step<10>> step;
+  for (int i = 0; i < 25; ++i) {
+    step.push_back(i);
+  }
+  EXPECT_EQ(step.capacity(), 30u);
+
+  circular_buffer<int, std::allocator<int>, modulo_index, grow_by_factor<3, 2, 4>> factor;
+  std::vector<size_t> capacities;
+  for (int i = 0; i < 20; ++i) {
+    factor.push_back(i);
+    if (capacities.empty() || capacities.back() != factor.capacity()) {
+      capacities.push_back(factor.capacity());
+    }
+  }
+  EXPECT_EQ(capacities, (std::vector<size_t>{4, 6, 9, 13, 19, 28}));
+
+  circular_buffer<int, std::allocator<int>, modulo_index, grow_to_pages<>> pages;
+  pages.push_back(1);
+  EXPECT_EQ(pages.capacity() * sizeof(int) % 4096, 0u);
+}
+
+TEST(circular_buffer, stats_count_usage) {
+  circular_buffer<int, std::allocator<int>, modulo_index, fixed_capacity, buffer_stats> b(4);
+  for (int i = 0; i < 10; ++i) {
+    b.push_back(i);
+  }
+  EXPECT_EQ(b.stats().drops, 6u);
+  EXPECT_EQ(b.stats().peak_size, 4u);
+  // Only the construction allocated.
+  EXPECT_EQ(b.stats().reallocations, 1u);
+
+  circular_buffer<int, std::allocator<int>, modulo_index, double_growth, buffer_stats> g;
+  for (int i = 0; i < 9; ++i) {
+    g.push_back(i);
+  }
+  EXPECT_EQ(g.stats().reallocations, 5u);
+  EXPECT_EQ(g.stats().bytes_copied, (0 + 1 + 2 + 4 + 8) * sizeof(int));
+  EXPECT_EQ(g.stats().peak_size, 9u);
+  EXPECT_EQ(g.stats().wraps, 0u);
+  g.consume_front(8);
+  for (int i = 0; i < 8; ++i) {
+    g.push_back(i);
+  }
+  EXPECT_EQ(g.stats().wraps, 1u);
+}
+
+TEST(circular_buffer, pmr_draws_from_resource) {
+  unsigned char arena[1024];
+  std::pmr::monotonic_buffer_resource resource(arena, sizeof(arena), std::pmr::null_memory_resource());
+  pmr::circular_buffer<int> b(&resource);
+  for (int i = 0; i < 32; ++i) {
+    b.push_back(i);
+  }
+  EXPECT_GE(reinterpret_cast<unsigned char*>(b.data()), arena);
+  EXPECT_LT(reinterpret_cast<unsigned char*>(b.data()), arena + sizeof(arena));
+  EXPECT_EQ(b.get_allocator().resource(), &resource);
+}
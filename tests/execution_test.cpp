@@ -0,0 +1,48 @@
+#include "circular-buffer-execution.h"
+
+#include <gtest/gtest.h>
+
+#include "static-circular-buffer.h"
+
+#include <atomic>
+#if __cplusplus >= 202002L
+#include <ranges>
+#endif
+
+#if __cplusplus >= 202002L
+static_assert(std::ranges::random_access_range<circular_buffer<int>>);
+static_assert(std::ranges::sized_range<circular_buffer<int>>);
+static_assert(std::ranges::random_access_range<const circular_buffer<int>>);
+static_assert(std::ranges::random_access_range<static_circular_buffer<int, 8>>);
+static_assert(std::ranges::sized_range<static_circular_buffer<int, 8>>);
+#endif
+
+TEST(execution, parallel_algorithms_respect_the_wrap) {
+  circular_buffer<int> b(100);
+  for (int i = 0; i < 70; ++i) {
+    b.push_back(i);
+  }
+  b.consume_front(50);
+  for (int i = 70; i < 150; ++i) {
+    b.push_back(i);
+  }
+  ASSERT_FALSE(b.is_linearized());
+
+  std::atomic<long> total{0};
+  cb::for_each(std::execution::par, b, [&](int& v) {
+    total += v;
+    v *= 2;
+  });
+  EXPECT_EQ(total.load(), (50 + 149) * 100 / 2);
+  EXPECT_EQ(b.front(), 100);
+  long doubled = cb::transform_reduce(std::execution::par_unseq, b, 0L, std::plus<>(), [](int v) { return long(v); });
+  EXPECT_EQ(doubled, 2 * total.load());
+
+  for (size_t i = 0; i < b.size(); ++i) {
+    b[i] = static_cast<int>(i * 7919 % 100);
+  }
+  cb::sort(std::execution::par, b);
+  EXPECT_TRUE(std::is_sorted(b.begin(), b.end()));
+  cb::sort(std::execution::seq, b, std::greater<>());
+  EXPECT_TRUE(std::is_sorted(b.begin(), b.end(), std::greater<>()));
+}
@@ -0,0 +1,61 @@
+#include "huge-page-allocator.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+TEST(huge_page_allocator, storage_is_whole_huge_pages) {
+  huge_page_options options;
+  options.prefault = true;
+  huge_page_circular_buffer<int> b{huge_page_allocator<int>(options)};
+  b.reserve(1000);
+  EXPECT_EQ(b.capacity(), options.huge_page_size / sizeof(int));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b.data()) % options.huge_page_size, 0u);
+  for (int i = 0; i < 100000; ++i) {
+    b.push_back(i);
+  }
+  EXPECT_EQ(b[99999], 99999);
+}
+
+TEST(huge_page_allocator, options_travel_with_the_buffer) {
+  huge_page_options options;
+  options.huge_pages = false;
+  options.numa_node = 0;
+  options.prefault = true;
+  circular_buffer<std::string, huge_page_allocator<std::string>> s{huge_page_allocator<std::string>(options)};
+  for (int i = 0; i < 1000; ++i) {
+    s.push_back(std::to_string(i));
+  }
+  EXPECT_EQ(s[999], "999");
+  EXPECT_EQ(s.capacity() * sizeof(std::string) % static_cast<size_t>(sysconf(_SC_PAGESIZE)), 0u);
+  circular_buffer<std::string, huge_page_allocator<std::string>> copy = s;
+  EXPECT_EQ(copy.get_allocator().options().numa_node, 0);
+
+  circular_buffer<std::string, huge_page_allocator<std::string>> assigned;
+  assigned.push_back("old");
+  assigned = s;
+  EXPECT_EQ(assigned.get_allocator().options().numa_node, 0);
+  EXPECT_TRUE(assigned.get_allocator().options().prefault);
+  EXPECT_EQ(assigned[999], "999");
+  circular_buffer<std::string, huge_page_allocator<std::string>> moved;
+  moved = std::move(copy);
+  EXPECT_EQ(moved.get_allocator().options().numa_node, 0);
+
+  // Neither has storage, so both compare equal, yet the options still travel.
+  circular_buffer<std::string, huge_page_allocator<std::string>> empty{huge_page_allocator<std::string>(options)};
+  circular_buffer<std::string, huge_page_allocator<std::string>> empty_assigned;
+  empty_assigned = empty;
+  EXPECT_EQ(empty_assigned.get_allocator().options().numa_node, 0);
+  circular_buffer<std::string, huge_page_allocator<std::string>> empty_moved;
+  empty_moved = std::move(empty);
+  EXPECT_EQ(empty_moved.get_allocator().options().numa_node, 0);
+}
+
+TEST(huge_page_allocator, bad_node_throws) {
+  huge_page_options options;
+  options.huge_pages = false;
+  options.numa_node = 63;
+  using buffer = circular_buffer<int, huge_page_allocator<int>>;
+  EXPECT_THROW(buffer(10, huge_page_allocator<int>(options)), std::system_error);
+}
@@ -0,0 +1,163 @@
+#include "mapped-circular-buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+struct record {
+  uint64_t sequence;
+  double value;
+};
+
+// A fresh file name in the test temporary directory, removed afterwards.
+struct temp_path {
+  std::string path;
+
+  explicit temp_path(const char* name) : path(testing::TempDir() + name) {
+    unlink(path.c_str());
+  }
+
+  ~temp_path() {
+    unlink(path.c_str());
+  }
+};
+
+} // namespace
+
+TEST(mapped_circular_buffer, survives_reopening) {
+  temp_path file("mapped_ring.bin");
+  {
+    mapped_circular_buffer<record> r(file.path.c_str(), 10, 4);
+    for (uint64_t i = 0; i < 25; ++i) {
+      r.push_back({i, i * 0.5});
+    }
+    EXPECT_EQ(r.size(), 10u);
+    EXPECT_EQ(r.front().sequence, 15u);
+    EXPECT_EQ(r.back().sequence, 24u);
+    r.consume_front(3);
+    record batch[4] = {{100, 0}, {101, 0}, {102, 0}, {103, 0}};
+    r.append_n(batch, 4);
+    EXPECT_EQ(r.size(), 10u);
+    EXPECT_EQ(r.front().sequence, 19u);
+    r.sync();
+  }
+  {
+    mapped_circular_buffer<record> r(file.path.c_str(), 999);
+    EXPECT_EQ(r.capacity(), 10u);
+    ASSERT_EQ(r.size(), 10u);
+    EXPECT_EQ(r.front().sequence, 19u);
+    EXPECT_EQ(r.back().sequence, 103u);
+    EXPECT_EQ(r.array_one().second + r.array_two().second, 10u);
+    r.append_n(nullptr, 0);
+    record big[12];
+    for (uint64_t i = 0; i < 12; ++i) {
+      big[i] = {200 + i, 0};
+    }
+    r.append_n(big, 12);
+    EXPECT_EQ(r.front().sequence, 202u);
+    EXPECT_EQ(r.back().sequence, 211u);
+    r.clear();
+    EXPECT_TRUE(r.empty());
+  }
+}
+
+TEST(mapped_circular_buffer, rejects_other_files) {
+  temp_path file("mapped_ring_other.bin");
+  { mapped_circular_buffer<record> r(file.path.c_str(), 4); }
+  EXPECT_THROW(mapped_circular_buffer<double>(file.path.c_str(), 4), std::system_error);
+
+  temp_path junk("mapped_ring_junk.bin");
+  FILE* f = std::fopen(junk.path.c_str(), "w");
+  ASSERT_NE(f, nullptr);
+  std::fputs("hello world, not a ring at all..", f);
+  std::fclose(f);
+  EXPECT_THROW(mapped_circular_buffer<record>(junk.path.c_str(), 4), std::system_error);
+  EXPECT_THROW(mapped_circular_buffer<record>("/nonexistent/ring.bin", 4), std::system_error);
+}
+
+namespace {
+
+// Makes the ring look as if it was last opened by another kernel boot, as
+// after a power loss: the header's boot id sits after its seven 8-byte fields.
+void pretend_reboot(const std::string& path) {
+  int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  ASSERT_NE(fd, -1);
+  char other[40] = "not this boot";
+  ASSERT_EQ(pwrite(fd, other, sizeof(other), 56), static_cast<ssize_t>(sizeof(other)));
+  close(fd);
+}
+
+} // namespace
+
+TEST(mapped_circular_buffer, reboot_recovers_the_synced_range) {
+  temp_path file("mapped_ring_reboot.bin");
+  {
+    mapped_circular_buffer<record> r(file.path.c_str(), 16);
+    for (uint64_t i = 0; i < 5; ++i) {
+      r.push_back({i, 0});
+    }
+    r.sync();
+    for (uint64_t i = 5; i < 8; ++i) {
+      r.push_back({i, 0});
+    }
+    r.consume_front(2);
+  }
+  {
+    // Same boot: the page cache still holds every store.
+    mapped_circular_buffer<record> r(file.path.c_str(), 16);
+    ASSERT_EQ(r.size(), 6u);
+    EXPECT_EQ(r.front().sequence, 2u);
+    EXPECT_EQ(r.back().sequence, 7u);
+  }
+  pretend_reboot(file.path);
+  {
+    mapped_circular_buffer<record> r(file.path.c_str(), 16);
+    ASSERT_EQ(r.size(), 5u);
+    EXPECT_EQ(r.front().sequence, 0u);
+    EXPECT_EQ(r.back().sequence, 4u);
+    r.push_back({100, 0});
+    EXPECT_EQ(r.back().sequence, 100u);
+  }
+}
+
+TEST(mapped_circular_buffer, overwriting_shrinks_the_synced_range) {
+  temp_path file("mapped_ring_overwrite.bin");
+  {
+    mapped_circular_buffer<record> r(file.path.c_str(), 8);
+    for (uint64_t i = 0; i < 8; ++i) {
+      r.push_back({i, 0});
+    }
+    r.sync();
+    // Reuses the slots of 0, 1 and 2; the synced range drops them and one
+    // more, an eighth of the ring.
+    for (uint64_t i = 8; i < 11; ++i) {
+      r.push_back({i, 0});
+    }
+    EXPECT_EQ(r.front().sequence, 3u);
+  }
+  pretend_reboot(file.path);
+  {
+    mapped_circular_buffer<record> r(file.path.c_str(), 8);
+    ASSERT_EQ(r.size(), 4u);
+    EXPECT_EQ(r.front().sequence, 4u);
+    EXPECT_EQ(r.back().sequence, 7u);
+  }
+
+  temp_path lapped("mapped_ring_lapped.bin");
+  {
+    mapped_circular_buffer<record> r(lapped.path.c_str(), 8);
+    r.push_back({0, 0});
+    r.sync();
+    for (uint64_t i = 1; i < 30; ++i) {
+      r.push_back({i, 0});
+    }
+  }
+  pretend_reboot(lapped.path);
+  {
+    mapped_circular_buffer<record> r(lapped.path.c_str(), 8);
+    EXPECT_TRUE(r.empty());
+  }
+}
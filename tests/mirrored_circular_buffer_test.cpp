@@ -0,0 +1,52 @@
+#include "mirrored-circular-buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <vector>
+
+TEST(mirrored_circular_buffer, contents_are_contiguous_across_the_wrap) {
+  mirrored_circular_buffer<int> b(10);
+  size_t capacity = b.capacity();
+  EXPECT_EQ(capacity * sizeof(int) % static_cast<size_t>(sysconf(_SC_PAGESIZE)), 0u);
+  std::vector<int> src(capacity);
+  std::iota(src.begin(), src.end(), 0);
+  b.append_n(src.data(), capacity);
+  b.consume_front(capacity - 3);
+  for (int i = 0; i < 5; ++i) {
+    b.push_back(1000 + i);
+  }
+  ASSERT_EQ(b.size(), 8u);
+  const int* first = b.begin();
+  EXPECT_EQ(first[2], static_cast<int>(capacity) - 1);
+  EXPECT_EQ(first[3], 1000);
+  EXPECT_EQ(b.data()[0], 1000);
+  EXPECT_EQ(b.data()[capacity], 1000);
+  EXPECT_EQ(b.back(), 1004);
+}
+
+TEST(mirrored_circular_buffer, grows_copies_and_moves) {
+  mirrored_circular_buffer<int> b;
+  for (int i = 0; i < 5000; ++i) {
+    if (i % 2 == 0) {
+      b.push_back(i);
+    } else {
+      b.push_front(i);
+    }
+  }
+  EXPECT_EQ(b.size(), 5000u);
+  EXPECT_EQ(b.front(), 4999);
+  EXPECT_EQ(b.back(), 4998);
+  mirrored_circular_buffer<int> c = b;
+  EXPECT_TRUE(std::equal(b.begin(), b.end(), c.begin(), c.end()));
+  mirrored_circular_buffer<int> d = std::move(c);
+  EXPECT_TRUE(c.empty());
+  EXPECT_EQ(d[0], 4999);
+  d.pop_front();
+  d.pop_back();
+  EXPECT_EQ(d.size(), 4998u);
+  int* free = d.free_begin();
+  free[0] = 7;
+  d.commit_back(1);
+  EXPECT_EQ(d.back(), 7);
+}
@@ -0,0 +1,93 @@
+#include "mpmc-circular-buffer.h"
+
+#include "test-types.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(mpmc_circular_buffer, push_and_pop) {
+  mpmc_circular_buffer<int> q(3);
+  EXPECT_EQ(q.capacity(), 4u);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(q.try_push(i));
+  }
+  EXPECT_FALSE(q.try_push(4));
+  int out = -1;
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(q.try_pop(out));
+    EXPECT_EQ(out, i);
+  }
+  EXPECT_FALSE(q.try_pop(out));
+  EXPECT_EQ(mpmc_circular_buffer<int>(1).capacity(), 2u);
+}
+
+TEST(mpmc_circular_buffer, destroys_what_is_left) {
+  {
+    mpmc_circular_buffer<counted> q(4);
+    q.try_emplace(1);
+    q.try_emplace(2);
+    counted out;
+    q.try_pop(out);
+  }
+  EXPECT_EQ(counted::live, 0);
+}
+
+TEST(mpmc_circular_buffer, slots_honour_over_alignment) {
+  static_assert(alignof(over_aligned) > __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+  std::vector<std::unique_ptr<mpmc_circular_buffer<over_aligned>>> queues;
+  for (size_t capacity = 2; capacity <= 64; capacity *= 2) {
+    queues.push_back(std::make_unique<mpmc_circular_buffer<over_aligned>>(capacity));
+    mpmc_circular_buffer<over_aligned>& q = *queues.back();
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(q.try_emplace(i));
+      over_aligned out;
+      ASSERT_TRUE(q.try_pop(out));
+      EXPECT_EQ(out.value, i);
+    }
+  }
+  EXPECT_FALSE(over_aligned::misaligned);
+}
+
+TEST(mpmc_circular_buffer, every_value_arrives_once) {
+  constexpr int producers = 4;
+  constexpr int consumers = 4;
+  constexpr int per_producer = 50000;
+  mpmc_circular_buffer<int> q(128);
+  std::vector<std::atomic<int>> seen(producers * per_producer);
+  std::atomic<int> popped{0};
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < per_producer;) {
+        if (q.try_push(p * per_producer + i)) {
+          ++i;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&] {
+      int out;
+      while (popped.load() < producers * per_producer) {
+        if (q.try_pop(out)) {
+          seen[out].fetch_add(1);
+          popped.fetch_add(1);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  for (const std::atomic<int>& s : seen) {
+    ASSERT_EQ(s.load(), 1);
+  }
+}
@@ -0,0 +1,76 @@
+#include "seqlock-circular-buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct record {
+  uint64_t a;
+  uint64_t b;
+  uint32_t c;
+};
+
+} // namespace
+
+TEST(seqlock_circular_buffer, snapshots_detect_overwrites) {
+  seqlock_circular_buffer<record> r(1000);
+  EXPECT_EQ(r.capacity(), 1024u);
+  EXPECT_TRUE(r.view().empty());
+  for (uint64_t i = 0; i < 10; ++i) {
+    r.push_back({i, i, static_cast<uint32_t>(i)});
+  }
+  auto first = r.view();
+  EXPECT_EQ(first.size(), 10u);
+  EXPECT_TRUE(first.intact());
+  record out;
+  EXPECT_TRUE(first.read(3, out));
+  EXPECT_EQ(out.a, 3u);
+
+  for (uint64_t i = 10; i < 2000; ++i) {
+    r.push_back({i, i, static_cast<uint32_t>(i)});
+  }
+  EXPECT_FALSE(first.intact());
+  EXPECT_FALSE(first.read(3, out));
+  auto second = r.view();
+  EXPECT_EQ(second.size(), 1024u);
+  EXPECT_TRUE(second.read(0, out));
+  EXPECT_EQ(out.a, 2000u - 1024u);
+}
+
+TEST(seqlock_circular_buffer, readers_never_see_torn_records) {
+  seqlock_circular_buffer<record> r(256);
+  std::atomic<bool> stop{false};
+  std::atomic<long> bad{0};
+  std::thread writer([&] {
+    for (uint64_t i = 0; i < 500000; ++i) {
+      r.push_back({i, i * 3, static_cast<uint32_t>(i * 7)});
+    }
+    stop = true;
+  });
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 2; ++t) {
+    readers.emplace_back([&] {
+      while (!stop) {
+        auto view = r.view();
+        uint64_t last = 0;
+        bool first = true;
+        view.for_each([&](const record& e) {
+          if (e.b != e.a * 3 || e.c != static_cast<uint32_t>(e.a * 7) || (!first && e.a != last + 1)) {
+            ++bad;
+          }
+          first = false;
+          last = e.a;
+        });
+      }
+    });
+  }
+  writer.join();
+  for (std::thread& t : readers) {
+    t.join();
+  }
+  EXPECT_EQ(bad.load(), 0);
+}
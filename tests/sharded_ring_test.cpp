@@ -0,0 +1,87 @@
+#include "sharded-ring.h"
+
+#include "test-types.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(sharded_ring, drains_home_then_steals) {
+  {
+    sharded_ring<counted> r(3, 4);
+    EXPECT_EQ(r.capacity(), 4u);
+    EXPECT_EQ(r.shard_count(), 3u);
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_EQ(r.try_emplace(0, i), i < 4);
+    }
+    r.try_emplace(2, 100);
+    r.try_emplace(2, 101);
+    std::vector<int> seen;
+    auto collect = [&](counted* first, size_t count) {
+      for (size_t i = 0; i < count; ++i) {
+        seen.push_back(first[i].value);
+      }
+    };
+    // Shard 1 is empty, so its drainer steals from the fullest, shard 0.
+    EXPECT_EQ(r.drain(1, collect), 4u);
+    EXPECT_EQ(seen, (std::vector<int>{0, 1, 2, 3}));
+    EXPECT_EQ(r.drain(2, collect), 2u);
+    EXPECT_EQ(r.drain(1, collect), 0u);
+    for (int i = 0; i < 6; ++i) {
+      r.try_emplace(1, i);
+    }
+    r.try_emplace(0, 7);
+    EXPECT_EQ(r.drain_all([](counted*, size_t) {}), 5u);
+    r.try_emplace(1, 8);
+  }
+  EXPECT_EQ(counted::live, 0);
+}
+
+TEST(sharded_ring, ordered_drain_merges_by_key) {
+  struct event {
+    uint64_t sequence;
+    int shard;
+  };
+  constexpr int producers = 4;
+  constexpr int per_producer = 50000;
+  sharded_ring<event> r(producers, 1024);
+  std::atomic<uint64_t> sequence{0};
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < per_producer; ++i) {
+        uint64_t ticket = sequence.fetch_add(1);
+        while (!r.try_push(p, event{ticket, p})) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  std::atomic<long> unordered{0};
+  std::atomic<long> drained{0};
+  std::thread stealer([&] {
+    while (drained.load() < producers * per_producer) {
+      drained += r.drain(0, [](event*, size_t) {});
+    }
+  });
+  while (drained.load() < producers * per_producer) {
+    uint64_t last = 0;
+    bool first = true;
+    drained += r.drain_ordered([](const event& e) { return e.sequence; }, [&](event& e) {
+      if (!first && e.sequence < last) {
+        ++unordered;
+      }
+      first = false;
+      last = e.sequence;
+    });
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  stealer.join();
+  EXPECT_EQ(drained.load(), producers * per_producer);
+  EXPECT_EQ(unordered.load(), 0);
+}
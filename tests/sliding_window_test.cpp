@@ -0,0 +1,93 @@
+#include "sliding-window.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// An int whose copies throw once armed.
+struct fragile {
+  static inline bool armed = false;
+
+  int value = 0;
+
+  fragile() = default;
+
+  fragile(int v) : value(v) {}
+
+  fragile(const fragile& other) : value(other.value) {
+    if (armed) {
+      throw std::runtime_error("fragile");
+    }
+  }
+
+  fragile& operator=(const fragile&) = default;
+
+  fragile& operator+=(const fragile& other) {
+    value += other.value;
+    return *this;
+  }
+
+  fragile& operator-=(const fragile& other) {
+    value -= other.value;
+    return *this;
+  }
+};
+
+} // namespace
+
+TEST(sliding_window, aggregates_follow_the_window) {
+  constexpr size_t window = 16;
+  sliding_window<int, window_sum<int>> sum(window);
+  sliding_window<int, window_mean<int>> mean(window);
+  sliding_window<int, window_min<int>> lo(window);
+  sliding_window<int, window_max<int>> hi(window);
+  std::mt19937 random(1);
+  std::vector<int> samples;
+  for (int i = 0; i < 1000; ++i) {
+    int value = static_cast<int>(random() % 1000) - 500;
+    samples.push_back(value);
+    sum.push_back(value);
+    mean.push_back(value);
+    lo.push_back(value);
+    hi.push_back(value);
+    auto first = samples.end() - std::min(samples.size(), window);
+    int total = std::accumulate(first, samples.end(), 0);
+    ASSERT_EQ(sum.value(), total);
+    ASSERT_DOUBLE_EQ(mean.value(), static_cast<double>(total) / static_cast<double>(samples.end() - first));
+    ASSERT_EQ(lo.value(), *std::min_element(first, samples.end()));
+    ASSERT_EQ(hi.value(), *std::max_element(first, samples.end()));
+  }
+  EXPECT_TRUE(sum.full());
+  EXPECT_EQ(sum.samples().size(), window);
+  sum.clear();
+  EXPECT_TRUE(sum.empty());
+  EXPECT_EQ(sum.value(), 0);
+}
+
+TEST(sliding_window, throwing_copies_change_nothing) {
+  sliding_window<fragile, window_sum<fragile>> sum(3);
+  sum.push_back(1);
+  fragile::armed = true;
+  EXPECT_THROW(sum.push_back(2), std::runtime_error);
+  fragile::armed = false;
+  EXPECT_EQ(sum.size(), 1u);
+  EXPECT_EQ(sum.value().value, 1);
+
+  sum.push_back(3);
+  sum.push_back(4);
+  fragile::armed = true;
+  EXPECT_THROW(sum.push_back(5), std::runtime_error);
+  fragile::armed = false;
+  EXPECT_EQ(sum.size(), 3u);
+  EXPECT_EQ(sum.value().value, 8);
+  EXPECT_EQ(sum.samples().front().value, 1);
+
+  sum.push_back(5);
+  EXPECT_EQ(sum.value().value, 12);
+}
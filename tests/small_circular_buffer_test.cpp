@@ -0,0 +1,169 @@
+#include "small-circular-buffer.h"
+
+#include "test-types.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+template <typename Buffer>
+std::vector<typename Buffer::value_type> contents(const Buffer& buffer) {
+  return std::vector<typename Buffer::value_type>(buffer.begin(), buffer.end());
+}
+
+}
+
+TEST(small_circular_buffer, stays_inline_up_to_n) {
+  small_circular_buffer<int, 16> s;
+  EXPECT_EQ(s.capacity(), 16u);
+  EXPECT_FALSE(s.on_heap());
+  for (int round = 0; round < 100; ++round) {
+    for (int i = 0; i < 10; ++i) {
+      s.push_back(i);
+    }
+    for (int i = 0; i < 10; ++i) {
+      s.pop_front();
+    }
+  }
+  EXPECT_FALSE(s.on_heap());
+  for (int i = 0; i < 40; ++i) {
+    s.push_back(i);
+  }
+  EXPECT_TRUE(s.on_heap());
+  EXPECT_EQ(s.size(), 40u);
+}
+
+TEST(small_circular_buffer, copies_and_moves) {
+  small_circular_buffer<int, 16> s;
+  for (int i = 0; i < 40; ++i) {
+    s.push_back(i);
+  }
+  small_circular_buffer<int, 16> t = s;
+  EXPECT_TRUE(t.on_heap());
+  EXPECT_EQ(t[39], 39);
+  small_circular_buffer<int, 16> u = std::move(s);
+  EXPECT_TRUE(u.on_heap());
+  EXPECT_EQ(u[39], 39);
+  EXPECT_FALSE(s.on_heap());
+  EXPECT_EQ(s.capacity(), 16u);
+
+  u.erase(u.begin() + 5, u.end());
+  u.shrink_to_fit();
+  EXPECT_FALSE(u.on_heap());
+  EXPECT_EQ(u.size(), 5u);
+  EXPECT_EQ(u[4], 4);
+
+  small_circular_buffer<int, 16> w;
+  w.push_back(7);
+  swap(u, w);
+  EXPECT_EQ(w.size(), 5u);
+  EXPECT_EQ(u.size(), 1u);
+  EXPECT_EQ(u[0], 7);
+  EXPECT_FALSE(u.on_heap());
+}
+
+TEST(small_circular_buffer, arena_never_leaves_the_object) {
+  using small = small_circular_buffer<int, 4, pow2_index>;
+  using base = circular_buffer<int, small_buffer_allocator<int, 4>, pow2_index>;
+  static_assert(!std::is_convertible_v<small&, base&>);
+  static_assert(!std::is_constructible_v<base, small&&>);
+
+  small s;
+  for (int i = 0; i < 3; ++i) {
+    s.push_back(i);
+  }
+  small t = std::move(s);
+  EXPECT_FALSE(t.on_heap());
+  EXPECT_NE(t.data(), s.data());
+  EXPECT_EQ(contents(t), (std::vector<int>{0, 1, 2}));
+}
+
+TEST(small_circular_buffer, shrink_returns_to_full_arena) {
+  small_circular_buffer<int, 4, pow2_index> s;
+  for (int i = 0; i < 8; ++i) {
+    s.push_back(i);
+  }
+  EXPECT_TRUE(s.on_heap());
+  s.erase(s.begin() + 3, s.end());
+  s.shrink_to_fit();
+  EXPECT_FALSE(s.on_heap());
+  EXPECT_EQ(s.capacity(), 4u);
+  s.push_back(3);
+  EXPECT_FALSE(s.on_heap());
+  EXPECT_EQ(contents(s), (std::vector<int>{0, 1, 2, 3}));
+
+  s.shrink_to_fit();
+  EXPECT_EQ(s.capacity(), 4u);
+  s.clear();
+  s.push_back(1);
+  s.push_back(2);
+  s.push_back(3);
+  s.push_back(4);
+  s.push_back(5);
+  s.clear();
+  s.shrink_to_fit();
+  EXPECT_FALSE(s.on_heap());
+  EXPECT_EQ(s.capacity(), 4u);
+}
+
+TEST(small_circular_buffer, inline_contents_move_element_by_element) {
+  {
+    small_circular_buffer<counted, 4, pow2_index> a;
+    small_circular_buffer<counted, 4, pow2_index> b;
+    for (int i = 0; i < 3; ++i) {
+      a.emplace_back(i);
+    }
+    b = std::move(a);
+    EXPECT_EQ(b.size(), 3u);
+    EXPECT_FALSE(b.on_heap());
+    EXPECT_EQ(b[2].value, 2);
+    for (int i = 0; i < 10; ++i) {
+      b.emplace_back(i);
+    }
+    EXPECT_TRUE(b.on_heap());
+    a = b;
+    a = std::move(b);
+    EXPECT_EQ(a.size(), 13u);
+    EXPECT_TRUE(b.empty());
+  }
+  EXPECT_EQ(counted::live, 0);
+}
+
+TEST(small_circular_buffer, linearize_stays_inline) {
+  {
+    small_circular_buffer<throwing_copy, 4> s;
+    for (int i = 0; i < 4; ++i) {
+      s.push_back(throwing_copy(i));
+    }
+    s.pop_front();
+    s.pop_front();
+    s.push_back(throwing_copy(4));
+    ASSERT_FALSE(s.is_linearized());
+    throwing_copy* first = s.linearize();
+    EXPECT_FALSE(s.on_heap());
+    EXPECT_TRUE(s.is_linearized());
+    EXPECT_EQ(first, s.data());
+    ASSERT_EQ(s.size(), 3u);
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ(first[i].value, throwing_copy(i + 2).value);
+    }
+  }
+  EXPECT_EQ(throwing_copy::live, 0);
+}
+
+TEST(small_circular_buffer, survives_relocation_in_a_vector) {
+  std::vector<small_circular_buffer<std::string, 4, pow2_index>> v;
+  for (int i = 0; i < 20; ++i) {
+    v.emplace_back();
+    v.back().push_back(std::string(30, 'a' + i));
+  }
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_EQ(v[i].size(), 1u);
+    EXPECT_EQ(v[i][0], std::string(30, 'a' + i));
+    EXPECT_FALSE(v[i].on_heap());
+  }
+}
@@ -0,0 +1,89 @@
+#include "spsc-circular-buffer.h"
+
+#include "test-types.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(spsc_circular_buffer, push_and_pop) {
+  spsc_circular_buffer<int> q(5);
+  EXPECT_EQ(q.capacity(), 8u);
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(q.try_push(i));
+  }
+  EXPECT_FALSE(q.try_push(8));
+  int out = -1;
+  EXPECT_TRUE(q.try_pop(out));
+  EXPECT_EQ(out, 0);
+  EXPECT_EQ(q.size(), 7u);
+
+  int batch[10] = {};
+  EXPECT_EQ(q.try_pop_n(batch, 10), 7u);
+  EXPECT_EQ(batch[6], 7);
+  EXPECT_FALSE(q.try_pop(out));
+  int src[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  EXPECT_EQ(q.try_push_n(src, 12), 8u);
+  EXPECT_EQ(q.try_pop_n(batch, 3), 3u);
+  EXPECT_EQ(batch[2], 2);
+}
+
+TEST(spsc_circular_buffer, destroys_what_is_left) {
+  {
+    spsc_circular_buffer<counted> q(4);
+    q.try_emplace(1);
+    q.try_emplace(2);
+  }
+  EXPECT_EQ(counted::live, 0);
+}
+
+TEST(spsc_circular_buffer, slots_honour_over_alignment) {
+  static_assert(alignof(over_aligned) > __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+  std::vector<std::unique_ptr<spsc_circular_buffer<over_aligned>>> queues;
+  for (size_t capacity = 1; capacity <= 64; capacity *= 2) {
+    queues.push_back(std::make_unique<spsc_circular_buffer<over_aligned>>(capacity));
+    spsc_circular_buffer<over_aligned>& q = *queues.back();
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(q.try_emplace(i));
+      over_aligned out;
+      ASSERT_TRUE(q.try_pop(out));
+      EXPECT_EQ(out.value, i);
+    }
+  }
+  EXPECT_FALSE(over_aligned::misaligned);
+}
+
+TEST(spsc_circular_buffer, hands_over_in_order) {
+  constexpr int count = 200000;
+  spsc_circular_buffer<int> q(64);
+  std::thread producer([&] {
+    for (int i = 0; i < count;) {
+      if (i % 7 == 0) {
+        int batch[5] = {i, i + 1, i + 2, i + 3, i + 4};
+        size_t pushed = q.try_push_n(batch, std::min(5, count - i));
+        if (pushed == 0) {
+          std::this_thread::yield();
+        }
+        i += static_cast<int>(pushed);
+      } else if (q.try_push(i)) {
+        ++i;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  int expected = 0;
+  while (expected < count) {
+    int out;
+    if (q.try_pop(out)) {
+      ASSERT_EQ(out, expected);
+      ++expected;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(q.empty());
+}
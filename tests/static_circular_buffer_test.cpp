@@ -0,0 +1,98 @@
+#include "static-circular-buffer.h"
+
+#include "test-types.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr static_circular_buffer<int, 8> make_table() {
+  static_circular_buffer<int, 8> b;
+  for (int i = 0; i < 12; ++i) {
+    b.push_back(i * i);
+  }
+  b.push_front(-1);
+  return b;
+}
+
+constexpr static_circular_buffer<int, 8> table = make_table();
+
+constexpr int table_sum() {
+  int total = 0;
+  for (int x : table) {
+    total += x;
+  }
+  return total;
+}
+
+static_assert(table.size() == 8 && table[0] == -1 && table[1] == 16 && table.back() == 100);
+static_assert(table_sum() == -1 + 16 + 25 + 36 + 49 + 64 + 81 + 100);
+static_assert(sizeof(static_circular_buffer<int, 8>) == 8 * sizeof(int) + 2 * sizeof(size_t));
+
+} // namespace
+
+TEST(static_circular_buffer, overwrites_like_bounded) {
+  static_circular_buffer<std::string, 4> s;
+  std::vector<std::string> model;
+  for (int i = 0; i < 20; ++i) {
+    s.push_back(std::to_string(i));
+    model.push_back(std::to_string(i));
+    if (model.size() > 4) {
+      model.erase(model.begin());
+    }
+    if (i % 3 == 0) {
+      s.pop_front();
+      model.erase(model.begin());
+    }
+  }
+  ASSERT_EQ(s.size(), model.size());
+  EXPECT_TRUE(std::equal(s.begin(), s.end(), model.begin(), model.end()));
+  s.emplace_front(3, 'x');
+  EXPECT_EQ(s.front(), "xxx");
+  s.clear();
+  EXPECT_TRUE(s.empty());
+}
+
+TEST(static_circular_buffer, copies_and_moves) {
+  {
+    static_circular_buffer<counted, 4> s;
+    for (int i = 0; i < 6; ++i) {
+      s.emplace_back(i);
+    }
+    static_circular_buffer<counted, 4> c = s;
+    static_circular_buffer<counted, 4> m = std::move(c);
+    EXPECT_TRUE(std::equal(m.begin(), m.end(), s.begin(), s.end()));
+    c = s;
+    c = std::move(m);
+    EXPECT_TRUE(std::equal(c.rbegin(), c.rend(), s.rbegin(), s.rend()));
+    EXPECT_EQ(c.array_one().second + c.array_two().second, 4u);
+  }
+  EXPECT_EQ(counted::live, 0);
+}
+
+TEST(static_circular_buffer, throwing_copy_and_move_leak_nothing) {
+  {
+    static_circular_buffer<throwing_copy, 4> s;
+    for (int i = 0; i < 6; ++i) {
+      s.emplace_back(i);
+    }
+    throwing_copy::arm(2);
+    EXPECT_THROW((static_circular_buffer<throwing_copy, 4>(s)), std::runtime_error);
+    throwing_copy::arm(2);
+    throwing_copy::throwing_moves = true;
+    EXPECT_THROW((static_circular_buffer<throwing_copy, 4>(std::move(s))), std::runtime_error);
+    throwing_copy::throwing_moves = false;
+    throwing_copy::arm(-1);
+
+    static_circular_buffer<throwing_copy, 4> c;
+    throwing_copy::arm(3);
+    EXPECT_THROW(c = s, std::runtime_error);
+    throwing_copy::arm(-1);
+    EXPECT_TRUE(c.empty());
+    EXPECT_EQ(s.size(), 4u);
+  }
+  EXPECT_EQ(throwing_copy::live, 0);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Element types shared by the tests.
+
+// Counts live instances, so a test can check that everything built was
+// destroyed exactly once.
+struct counted {
+  static inline long live = 0;
+
+  int value;
+
+  counted(int v = 0) : value(v) {
+    ++live;
+  }
+
+  counted(const counted& other) : value(other.value) {
+    ++live;
+  }
+
+  counted(counted&& other) noexcept : value(other.value) {
+    ++live;
+  }
+
+  counted& operator=(const counted&) = default;
+  counted& operator=(counted&&) noexcept = default;
+
+  ~counted() {
+    --live;
+  }
+
+  friend bool operator==(const counted& a, const counted& b) {
+    return a.value == b.value;
+  }
+};
+
+// Owns heap memory and throws from its copy constructor once copies_left
+// reaches zero. Moves never throw unless throwing_moves is set.
+struct throwing_copy {
+  static inline long live = 0;
+  static inline long copies_left = -1;
+  static inline bool throwing_moves = false;
+
+  std::string value;
+
+  throwing_copy(int v = 0) : value(std::to_string(v) + std::string(32, '.')) {
+    ++live;
+  }
+
+  throwing_copy(const throwing_copy& other) : value(other.value) {
+    tick();
+    ++live;
+  }
+
+  throwing_copy(throwing_copy&& other) noexcept(false) : value(std::move(other.value)) {
+    if (throwing_moves) {
+      tick();
+    }
+    ++live;
+  }
+
+  throwing_copy& operator=(const throwing_copy& other) {
+    tick();
+    value = other.value;
+    return *this;
+  }
+
+  throwing_copy& operator=(throwing_copy&& other) noexcept {
+    value = std::move(other.value);
+    return *this;
+  }
+
+  ~throwing_copy() {
+    --live;
+  }
+
+  // Arms the next count copies to succeed and the one after to throw;
+  // -1 disarms.
+  static void arm(long count) {
+    copies_left = count;
+  }
+
+private:
+  static void tick() {
+    if (copies_left == 0) {
+      throw std::runtime_error("throwing_copy");
+    }
+    if (copies_left > 0) {
+      --copies_left;
+    }
+  }
+};
+
+// Aligned past what plain operator new guarantees. Notes whether any
+// instance was ever built at an address that does not honour that.
+struct alignas(64) over_aligned {
+  static inline bool misaligned = false;
+
+  int value;
+
+  over_aligned(int v = 0) noexcept : value(v) {
+    check();
+  }
+
+  over_aligned(const over_aligned& other) noexcept : value(other.value) {
+    check();
+  }
+
+  over_aligned& operator=(const over_aligned&) = default;
+
+private:
+  void check() const noexcept {
+    if (reinterpret_cast<uintptr_t>(this) % alignof(over_aligned) != 0) {
+      misaligned = true;
+    }
+  }
+};
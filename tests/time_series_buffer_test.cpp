@@ -0,0 +1,39 @@
+#include "time-series-buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(time_series_buffer, searches_by_time_across_the_wrap) {
+  time_series_buffer<double> ts(8);
+  for (int i = 0; i < 6; ++i) {
+    ts.push_back(i * 10, i);
+  }
+  EXPECT_EQ(ts.expire_before(25), 3u);
+  EXPECT_EQ(ts.size(), 3u);
+  EXPECT_EQ(ts.timestamp(0), 30);
+  for (int i = 6; i < 10; ++i) {
+    ts.push_back(i * 10, i);
+  }
+  ASSERT_NE(ts.times().array_two().second, 0u);
+  EXPECT_EQ(ts.lower_bound(75), ts.size() - 2);
+  EXPECT_EQ(ts.lower_bound(80), ts.size() - 2);
+  EXPECT_EQ(ts.upper_bound(80), ts.size() - 1);
+  EXPECT_EQ(ts.lower_bound(0), 0u);
+  EXPECT_EQ(ts.lower_bound(1000), ts.size());
+  EXPECT_EQ(ts.expire_before(60), 3u);
+  EXPECT_EQ(ts[0], 6);
+  EXPECT_EQ(ts.values().size(), ts.times().size());
+}
+
+TEST(time_series_buffer, fixed_capacity_overwrites_oldest) {
+  time_series_buffer<std::string, int64_t, fixed_capacity> ts(4);
+  for (int i = 0; i < 10; ++i) {
+    ts.push_back(i, std::to_string(i));
+  }
+  EXPECT_EQ(ts.size(), 4u);
+  EXPECT_EQ(ts[0], "6");
+  EXPECT_EQ(ts.lower_bound(8), 2u);
+  EXPECT_EQ(ts.expire_before(100), 4u);
+  EXPECT_TRUE(ts.empty());
+}
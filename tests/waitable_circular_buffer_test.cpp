@@ -0,0 +1,98 @@
+#include "waitable-circular-buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(waitable_circular_buffer, threads_block_until_ready) {
+  constexpr int producers = 3;
+  constexpr int consumers = 3;
+  constexpr long per_thread = 20000;
+  waitable_circular_buffer<long> ring(8, 4);
+  std::atomic<long> total{0};
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&] {
+      for (long i = 1; i <= per_thread; ++i) {
+        ring.push_wait(i);
+      }
+    });
+  }
+  for (int c = 0; c < consumers; ++c) {
+    threads.emplace_back([&] {
+      for (long i = 0; i < per_thread; ++i) {
+        total += ring.pop_wait();
+      }
+    });
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(total.load(), producers * per_thread * (per_thread + 1) / 2);
+  EXPECT_TRUE(ring.empty());
+}
+
+#ifdef CIRCULAR_BUFFER_COROUTINES
+namespace {
+
+struct task {
+  struct promise_type {
+    task get_return_object() noexcept {
+      return {};
+    }
+
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+
+    void return_void() noexcept {}
+
+    void unhandled_exception() noexcept {
+      std::terminate();
+    }
+  };
+};
+
+task consume(waitable_circular_buffer<int>& ring, int count, long& total, bool& done) {
+  for (int i = 0; i < count; ++i) {
+    total += co_await ring.pop();
+  }
+  done = true;
+}
+
+task produce(waitable_circular_buffer<int>& ring, int from, int count) {
+  for (int i = 0; i < count; ++i) {
+    co_await ring.push(from + i);
+  }
+}
+
+} // namespace
+
+TEST(waitable_circular_buffer, coroutines_suspend_and_resume) {
+  waitable_circular_buffer<int> ring(4, 2);
+  long total = 0;
+  bool done = false;
+  consume(ring, 10, total, done);
+  EXPECT_FALSE(done);
+  for (int i = 1; i <= 10; ++i) {
+    ring.push_wait(i);
+  }
+  EXPECT_TRUE(done);
+  EXPECT_EQ(total, 55);
+
+  produce(ring, 100, 10);
+  EXPECT_EQ(ring.size(), 4u);
+  long popped = 0;
+  for (int i = 0; i < 10; ++i) {
+    popped += ring.pop_wait();
+  }
+  EXPECT_EQ(popped, 1045);
+  EXPECT_TRUE(ring.empty());
+}
+#endif
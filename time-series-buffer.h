@@ -0,0 +1,130 @@
+#pragma once
+
+#include "circular-buffer.h"
+
+#include <cstdint>
+
+// Samples ordered by time, kept as two lanes in step: one circular_buffer of
+// timestamps and one of values, so scans over either lane touch only that
+// lane (array_one() and array_two() of times() or values()). Timestamps must
+// not decrease, so lookups by time are binary searches on the two runs of
+// the timestamp lane, and expiry by age drops a whole prefix at once.
+template <typename Value, typename Timestamp = int64_t, typename Growth = double_growth>
+class time_series_buffer {
+  using time_lane = circular_buffer<Timestamp, std::allocator<Timestamp>, modulo_index, Growth>;
+  using value_lane = circular_buffer<Value, std::allocator<Value>, modulo_index, Growth>;
+
+  static_assert(std::is_nothrow_copy_constructible_v<Timestamp>, "timestamps are pushed last and must not throw");
+
+  time_lane times_;
+  value_lane values_;
+
+public:
+  using value_type = Value;
+  using timestamp_type = Timestamp;
+
+  // O(1), nothrow
+  time_series_buffer() noexcept = default;
+
+  // O(n), strong
+  explicit time_series_buffer(size_t capacity) : times_(capacity), values_(capacity) {}
+
+  // O(1), nothrow
+  size_t size() const noexcept {
+    return times_.size();
+  }
+
+  // O(1), nothrow
+  bool empty() const noexcept {
+    return times_.empty();
+  }
+
+  // O(1), nothrow
+  size_t capacity() const noexcept {
+    return std::min(times_.capacity(), values_.capacity());
+  }
+
+  // O(1), nothrow
+  const time_lane& times() const noexcept {
+    return times_;
+  }
+
+  // O(1), nothrow
+  const value_lane& values() const noexcept {
+    return values_;
+  }
+
+  // O(1), nothrow
+  const Timestamp& timestamp(size_t index) const {
+    return times_[index];
+  }
+
+  // O(1), nothrow
+  Value& operator[](size_t index) {
+    return values_[index];
+  }
+
+  // O(1), nothrow
+  const Value& operator[](size_t index) const {
+    return values_[index];
+  }
+
+  // O(1) amortized, strong
+  // In overwrite mode a full buffer drops its oldest sample.
+  void push_back(const Timestamp& time, const Value& val) {
+    assert(empty() || !(time < times_.back()));
+    values_.push_back(val);
+    try {
+      times_.push_back(time);
+    } catch (...) {
+      values_.pop_back();
+      throw;
+    }
+  }
+
+  // O(log n), nothrow
+  // Index of the first sample not older than time, or size().
+  size_t lower_bound(const Timestamp& time) const noexcept {
+    return search(time, [](const Timestamp& a, const Timestamp& b) { return a < b; });
+  }
+
+  // O(log n), nothrow
+  // Index of the first sample newer than time, or size().
+  size_t upper_bound(const Timestamp& time) const noexcept {
+    return search(time, [](const Timestamp& a, const Timestamp& b) { return !(b < a); });
+  }
+
+  // O(log n), O(log n + k) for values that are not trivially destructible, nothrow
+  // Drops every sample older than cutoff and returns how many there were.
+  size_t expire_before(const Timestamp& cutoff) noexcept {
+    size_t count = lower_bound(cutoff);
+    times_.consume_front(count);
+    values_.consume_front(count);
+    return count;
+  }
+
+  // O(n), O(1) for trivially destructible values, nothrow
+  void clear() noexcept {
+    times_.clear();
+    values_.clear();
+  }
+
+private:
+  // Number of leading timestamps t with before(t, time), searching the
+  // second run only when the whole first one qualifies.
+  template <typename Before>
+  size_t search(const Timestamp& time, Before before) const noexcept {
+    auto partition = [&](const Timestamp* first, size_t count) {
+      return static_cast<size_t>(std::partition_point(first, first + count,
+                                                      [&](const Timestamp& t) { return before(t, time); }) -
+                                 first);
+    };
+    typename time_lane::const_array_range one = times_.array_one();
+    size_t index = partition(one.first, one.second);
+    if (index == one.second) {
+      typename time_lane::const_array_range two = times_.array_two();
+      index += partition(two.first, two.second);
+    }
+    return index;
+  }
+};
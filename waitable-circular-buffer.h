@@ -0,0 +1,310 @@
+#pragma once
+
+#include "mpmc-circular-buffer.h"
+
+#include <version>
+
+#ifndef __cpp_lib_atomic_wait
+#error "waitable_circular_buffer needs C++20 std::atomic::wait"
+#endif
+
+#include <mutex>
+
+#if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+#include <coroutine>
+#define CIRCULAR_BUFFER_COROUTINES 1
+#endif
+
+// mpmc_circular_buffer that can also wait: a thread blocks in push_wait or
+// pop_wait, and a coroutine suspends in co_await push(val) or co_await pop().
+// A waiter first spins on the lock-free ring, then sleeps on an epoch that
+// every push (or pop) bumps, through std::atomic::wait. Producers and
+// consumers only notify while somebody sleeps, so a busy pipeline never
+// makes a system call. Suspended coroutines are handed their value and
+// resumed on the thread that made it available. T must be default
+// constructible for popping, as with try_pop(T&).
+template <typename T>
+class waitable_circular_buffer {
+  mpmc_circular_buffer<T> ring_;
+  size_t spin_;
+
+  alignas(cache_line_size) std::atomic<uint32_t> pushes_;
+  std::atomic<uint32_t> sleeping_consumers_;
+
+  alignas(cache_line_size) std::atomic<uint32_t> pops_;
+  std::atomic<uint32_t> sleeping_producers_;
+
+#ifdef CIRCULAR_BUFFER_COROUTINES
+  struct pop_awaiter;
+  struct push_awaiter;
+
+  // Suspended coroutines, oldest first.
+  std::mutex mutex_;
+  pop_awaiter* consumers_ = nullptr;
+  pop_awaiter** consumers_end_ = &consumers_;
+  push_awaiter* producers_ = nullptr;
+  push_awaiter** producers_end_ = &producers_;
+#endif
+
+public:
+  using value_type = T;
+
+  // O(n), strong
+  // Waiters retry the ring spin times before they sleep.
+  explicit waitable_circular_buffer(size_t capacity, size_t spin = 64)
+      : ring_(capacity), spin_(spin), pushes_(0), sleeping_consumers_(0), pops_(0), sleeping_producers_(0) {}
+
+  waitable_circular_buffer(const waitable_circular_buffer&) = delete;
+  waitable_circular_buffer& operator=(const waitable_circular_buffer&) = delete;
+
+  // O(n), nothrow
+  // No thread or coroutine may still be waiting.
+  ~waitable_circular_buffer() {
+#ifdef CIRCULAR_BUFFER_COROUTINES
+    assert(consumers_ == nullptr && producers_ == nullptr);
+#endif
+  }
+
+  // O(1), nothrow
+  size_t capacity() const noexcept {
+    return ring_.capacity();
+  }
+
+  // O(1), nothrow
+  // Only a snapshot while other threads are pushing or popping.
+  size_t size() const noexcept {
+    return ring_.size();
+  }
+
+  // O(1), nothrow
+  bool empty() const noexcept {
+    return ring_.empty();
+  }
+
+  // O(1), strong
+  bool try_push(const T& val) {
+    T tmp = val;
+    return try_push(std::move(tmp));
+  }
+
+  // O(1), nothrow
+  // Returns false and leaves val untouched when the ring is full.
+  bool try_push(T&& val) noexcept {
+    if (!ring_.try_push(std::move(val))) {
+      return false;
+    }
+    pushed();
+    return true;
+  }
+
+  // O(1), nothrow
+  bool try_pop(T& out) noexcept {
+    if (!ring_.try_pop(out)) {
+      return false;
+    }
+    popped();
+    return true;
+  }
+
+  // Blocks while the ring is full.
+  void push_wait(const T& val) {
+    T tmp = val;
+    push_wait(std::move(tmp));
+  }
+
+  // Blocks while the ring is full.
+  void push_wait(T&& val) noexcept {
+    wait_until([&] { return try_push(std::move(val)); }, pops_, sleeping_producers_);
+  }
+
+  // Blocks while the ring is empty.
+  void pop_wait(T& out) noexcept {
+    wait_until([&] { return try_pop(out); }, pushes_, sleeping_consumers_);
+  }
+
+  // Blocks while the ring is empty.
+  T pop_wait() {
+    T out{};
+    pop_wait(out);
+    return out;
+  }
+
+#ifdef CIRCULAR_BUFFER_COROUTINES
+  // co_await ring.pop() yields the next value, suspending while the ring is empty.
+  pop_awaiter pop() noexcept {
+    return pop_awaiter{this};
+  }
+
+  // co_await ring.push(val) suspends while the ring is full.
+  push_awaiter push(T val) noexcept {
+    return push_awaiter{this, std::move(val)};
+  }
+#endif
+
+private:
+  static void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+  // Spins on attempt, then sleeps on epoch until it changes. The epoch is
+  // read before attempt and sleepers is raised before the sleep, so a push
+  // or pop that lands after the read either changes the epoch under wait or
+  // sees the sleeper and notifies.
+  template <typename Attempt>
+  void wait_until(Attempt attempt, std::atomic<uint32_t>& epoch, std::atomic<uint32_t>& sleepers) noexcept {
+    for (size_t i = 0; i < spin_; ++i) {
+      if (attempt()) {
+        return;
+      }
+      cpu_relax();
+    }
+    for (;;) {
+      uint32_t seen = epoch.load();
+      if (attempt()) {
+        return;
+      }
+      sleepers.fetch_add(1);
+      epoch.wait(seen);
+      sleepers.fetch_sub(1);
+    }
+  }
+
+  void pushed() noexcept {
+    pushes_.fetch_add(1);
+    if (sleeping_consumers_.load() != 0) {
+      pushes_.notify_one();
+#ifdef CIRCULAR_BUFFER_COROUTINES
+      resume_consumer();
+#endif
+    }
+  }
+
+  void popped() noexcept {
+    pops_.fetch_add(1);
+    if (sleeping_producers_.load() != 0) {
+      pops_.notify_one();
+#ifdef CIRCULAR_BUFFER_COROUTINES
+      resume_producer();
+#endif
+    }
+  }
+
+#ifdef CIRCULAR_BUFFER_COROUTINES
+  struct pop_awaiter {
+    waitable_circular_buffer* ring;
+    T value{};
+    std::coroutine_handle<> handle = nullptr;
+    pop_awaiter* next = nullptr;
+
+    bool await_ready() noexcept {
+      return ring->try_pop(value);
+    }
+
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+      handle = h;
+      return ring->park(this);
+    }
+
+    T await_resume() noexcept {
+      return std::move(value);
+    }
+  };
+
+  struct push_awaiter {
+    waitable_circular_buffer* ring;
+    T value;
+    std::coroutine_handle<> handle = nullptr;
+    push_awaiter* next = nullptr;
+
+    bool await_ready() noexcept {
+      return ring->try_push(std::move(value));
+    }
+
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+      handle = h;
+      return ring->park(this);
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  // Queues a suspending coroutine unless its value can be taken right away.
+  // Same handshake as wait_until, with the queue in place of the sleep.
+  // Returns whether the coroutine stays suspended.
+  bool park(pop_awaiter* a) noexcept {
+    std::unique_lock lock(mutex_);
+    for (;;) {
+      uint32_t seen = pushes_.load();
+      if (ring_.try_pop(a->value)) {
+        lock.unlock();
+        popped();
+        return false;
+      }
+      sleeping_consumers_.fetch_add(1);
+      if (pushes_.load() == seen) {
+        *consumers_end_ = a;
+        consumers_end_ = &a->next;
+        return true;
+      }
+      sleeping_consumers_.fetch_sub(1);
+    }
+  }
+
+  bool park(push_awaiter* a) noexcept {
+    std::unique_lock lock(mutex_);
+    for (;;) {
+      uint32_t seen = pops_.load();
+      if (ring_.try_push(std::move(a->value))) {
+        lock.unlock();
+        pushed();
+        return false;
+      }
+      sleeping_producers_.fetch_add(1);
+      if (pops_.load() == seen) {
+        *producers_end_ = a;
+        producers_end_ = &a->next;
+        return true;
+      }
+      sleeping_producers_.fetch_sub(1);
+    }
+  }
+
+  // Hands a value to the oldest suspended consumer, if any, and resumes it.
+  void resume_consumer() noexcept {
+    std::unique_lock lock(mutex_);
+    pop_awaiter* a = consumers_;
+    if (a == nullptr || !ring_.try_pop(a->value)) {
+      return;
+    }
+    consumers_ = a->next;
+    if (consumers_ == nullptr) {
+      consumers_end_ = &consumers_;
+    }
+    sleeping_consumers_.fetch_sub(1);
+    lock.unlock();
+    popped();
+    a->handle.resume();
+  }
+
+  // Moves the oldest suspended producer's value in, if any, and resumes it.
+  void resume_producer() noexcept {
+    std::unique_lock lock(mutex_);
+    push_awaiter* a = producers_;
+    if (a == nullptr || !ring_.try_push(std::move(a->value))) {
+      return;
+    }
+    producers_ = a->next;
+    if (producers_ == nullptr) {
+      producers_end_ = &producers_;
+    }
+    sleeping_producers_.fetch_sub(1);
+    lock.unlock();
+    pushed();
+    a->handle.resume();
+  }
+#endif
+};